@@ -0,0 +1,429 @@
+#pragma once
+/**
+ * @file compressor.hpp
+ * @brief Stereo linked lookahead compressor/limiter
+ *
+ * Copyright (c) 2020-2022 KORG Inc. All rights reserved.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+#include <arm_neon.h>
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Stereo linked feed-forward compressor/limiter with lookahead.
+   *
+   * Processing is split in passes over blocks of up to k_max_frames:
+   *  - Peak detection (NEON), max of both channels and of a half-sample
+   *    interpolated estimate to catch inter-sample peaks.
+   *  - Sliding window maximum over the lookahead window, with a monotonic
+   *    deque so cost is O(1) per sample regardless of window length.
+   *  - Gain computer in log2 domain with soft knee (NEON).
+   *  - Release smoothing followed by a moving average over the lookahead window,
+   *    so that gain reduction ramps in over the lookahead and is fully applied
+   *    when the peak reaches the output.
+   *  - Gain and makeup applied to the delayed input (NEON).
+   *
+   * With infinite ratio and zero knee, output sample peaks do not exceed the
+   * threshold plus makeup gain, inter-sample peaks stay within about 1dB of it
+   * up to a quarter of the sampling rate.
+   */
+  struct Compressor {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_max_frames = 64,
+      k_buffer_size = 512,
+      k_buffer_mask = k_buffer_size - 1,
+      k_max_lookahead = k_buffer_size - 32,
+      k_min_lookahead = 4,
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    Compressor(void) :
+      mFs(48000.f),
+      mThreshold(0.f),
+      mKnee(0.f),
+      mSlope(-1.f),
+      mMakeup(1.f),
+      mReleaseCoef(0.f),
+      mBoxScale(0.f),
+      mEnv(1.f),
+      mGain(1.f),
+      mWindow(0)
+    {
+      setRelease(0.1f);
+      setLookahead(0.002f);
+      reset();
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set sampling rate, lookahead and release times should be set again afterwards
+     *
+     * @param fs Sampling rate in Hz
+     */
+    inline void setSamplingRate(const float fs) {
+      mFs = fs;
+    }
+
+    /**
+     * Set threshold
+     *
+     * @param db Threshold in dBFS
+     */
+    inline void setThreshold(const float db) {
+      mThreshold = db * k_db_to_log2;
+    }
+
+    /**
+     * Set compression ratio
+     *
+     * @param ratio Ratio, values lower than 1 select infinite ratio (limiting)
+     */
+    inline void setRatio(const float ratio) {
+      mSlope = (ratio < 1.f) ? -1.f : 1.f / ratio - 1.f;
+    }
+
+    /**
+     * Set soft knee width
+     *
+     * @param db Knee width in dB, centered on threshold
+     */
+    inline void setKnee(const float db) {
+      mKnee = (db > 0.f) ? db * k_db_to_log2 : 0.f;
+    }
+
+    /**
+     * Set makeup gain
+     *
+     * @param db Gain in dB
+     */
+    inline void setMakeup(const float db) {
+      mMakeup = std::pow(10.f, 0.05f * db);
+    }
+
+    /**
+     * Set release time
+     *
+     * @param t Time constant in seconds
+     */
+    inline void setRelease(const float t) {
+      const float samples = t * mFs;
+      mReleaseCoef = (samples > 1.f) ? std::exp(-1.f / samples) : 0.f;
+    }
+
+    /**
+     * Set lookahead time, which is also the attack time
+     *
+     * @param t Time in seconds
+     *
+     * @note Changing lookahead changes latency and clears detector state.
+     */
+    inline void setLookahead(const float t) {
+      uint32_t w = (uint32_t)(t * mFs + 0.5f);
+      w = (w < k_min_lookahead) ? (uint32_t)k_min_lookahead : (w > k_max_lookahead) ? (uint32_t)k_max_lookahead : w;
+      if (w == mWindow)
+        return;
+      mWindow = w;
+      mBoxScale = 1.f / (w * k_gain_one);
+      resetDetector();
+    }
+
+    /**
+     * Get latency in samples introduced by lookahead
+     */
+    inline uint32_t getLatency(void) const {
+      return mWindow + 1;
+    }
+
+    /**
+     * Get gain applied to last processed sample, excluding makeup
+     */
+    inline float getGain(void) const {
+      return mGain;
+    }
+
+    /**
+     * Clear delay and detector state
+     */
+    inline void reset(void) {
+      for (uint32_t i = 0; i < 2 * k_buffer_size; ++i)
+        mDelay[i] = 0.f;
+      mWritePos = 0;
+      mHistL = vdupq_n_f32(0.f);
+      mHistR = vdupq_n_f32(0.f);
+      mEnv = 1.f;
+      mGain = 1.f;
+      resetDetector();
+    }
+
+    /**
+     * Process interleaved stereo samples
+     *
+     * @param in Input samples, interleaved stereo
+     * @param out Output samples, interleaved stereo, may be the same as in
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast")))
+    void process(const float * in, float * out, size_t frames) {
+      while (frames) {
+        const size_t n = (frames < k_max_frames) ? frames : (size_t)k_max_frames;
+        processChunk(in, out, n);
+        in += 2 * n;
+        out += 2 * n;
+        frames -= n;
+      }
+    }
+
+  private:
+
+    /*===========================================================================*/
+    /* Private Methods.                                                          */
+    /*===========================================================================*/
+
+    static constexpr float k_db_to_log2 = 0.16609640474f;  // 1 / (20 * log10(2))
+    static constexpr float k_gain_one = 4194304.f;          // Q22 unity for moving average
+
+    inline void resetDetector(void) {
+      mDqHead = mDqTail = 0;
+      mCount = 0;
+      const uint32_t q = (uint32_t)(mEnv * k_gain_one);
+      for (uint32_t i = 0; i < mWindow; ++i)
+        mBox[i] = q;
+      mBoxSum = q * mWindow;
+      mBoxPos = 0;
+    }
+
+    /**
+     * Approximate log2 for positive normal values, max error ~8e-4
+     */
+    static inline __attribute__((always_inline))
+    float32x4_t vlog2q(const float32x4_t x) {
+      const uint32x4_t bits = vreinterpretq_u32_f32(x);
+      const float32x4_t e = vcvtq_f32_u32(vshrq_n_u32(bits, 23));
+      const float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+      float32x4_t p = vmlaq_n_f32(vdupq_n_f32(-1.026804907f), m, 0.152700285f);
+      p = vmlaq_f32(vdupq_n_f32(3.011162151f), p, m);
+      p = vmlaq_f32(vdupq_n_f32(-2.136232065f - 127.f), p, m);
+      return vaddq_f32(e, p);
+    }
+
+    /**
+     * Approximate 2^x for x in [-126, 0], max relative error ~1e-4
+     */
+    static inline __attribute__((always_inline))
+    float32x4_t vexp2q(float32x4_t x) {
+      x = vmaxq_f32(x, vdupq_n_f32(-126.f));
+      int32x4_t i = vcvtq_s32_f32(x);
+      // Truncation rounds toward zero, step down for negative non-integers
+      const uint32x4_t adj = vcgtq_f32(vcvtq_f32_s32(i), x);
+      i = vaddq_s32(i, vreinterpretq_s32_u32(adj));
+      const float32x4_t f = vsubq_f32(x, vcvtq_f32_s32(i));
+      float32x4_t p = vmlaq_n_f32(vdupq_n_f32(0.224693156f), f, 0.078967257f);
+      p = vmlaq_f32(vdupq_n_f32(0.696324771f), p, f);
+      p = vmlaq_f32(vdupq_n_f32(0.999900288f), p, f);
+      const float32x4_t scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(i, vdupq_n_s32(127)), 23));
+      return vmulq_f32(p, scale);
+    }
+
+    /**
+     * Peak of samples and of half-sample interpolated points, one step behind
+     */
+    static inline __attribute__((always_inline))
+    float32x4_t vpeakq(const float32x4_t x0, const float32x4_t x1, const float32x4_t x2, const float32x4_t x3) {
+      // 4 point interpolation halfway between x1 and x2, x0 being the latest sample
+      float32x4_t mid = vmulq_n_f32(vaddq_f32(x1, x2), 0.5625f);
+      mid = vmlsq_n_f32(mid, vaddq_f32(x0, x3), 0.0625f);
+      return vmaxq_f32(vabsq_f32(x0), vabsq_f32(mid));
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void processChunk(const float * in, float * out, const size_t frames) {
+      float peak[k_max_frames];
+      float gain[k_max_frames];
+
+      // Peak detection, 4 frames at a time
+      {
+        float32x4_t hl = mHistL;
+        float32x4_t hr = mHistR;
+        size_t i = 0;
+        for (; i + 4 <= frames; i += 4) {
+          const float32x4x2_t x = vld2q_f32(in + 2 * i);
+          const float32x4_t pl = vpeakq(x.val[0], vextq_f32(hl, x.val[0], 3), vextq_f32(hl, x.val[0], 2), vextq_f32(hl, x.val[0], 1));
+          const float32x4_t pr = vpeakq(x.val[1], vextq_f32(hr, x.val[1], 3), vextq_f32(hr, x.val[1], 2), vextq_f32(hr, x.val[1], 1));
+          vst1q_f32(peak + i, vmaxq_f32(pl, pr));
+          hl = x.val[0];
+          hr = x.val[1];
+        }
+        if (i < frames) {
+          // Zero padded partial group, history then shifted by the number of valid frames
+          const size_t r = frames - i;
+          float tmp[8] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+          for (size_t j = 0; j < 2 * r; ++j)
+            tmp[j] = in[2 * i + j];
+          const float32x4x2_t x = vld2q_f32(tmp);
+          const float32x4_t pl = vpeakq(x.val[0], vextq_f32(hl, x.val[0], 3), vextq_f32(hl, x.val[0], 2), vextq_f32(hl, x.val[0], 1));
+          const float32x4_t pr = vpeakq(x.val[1], vextq_f32(hr, x.val[1], 3), vextq_f32(hr, x.val[1], 2), vextq_f32(hr, x.val[1], 1));
+          float p[4];
+          vst1q_f32(p, vmaxq_f32(pl, pr));
+          for (size_t j = 0; j < r; ++j)
+            peak[i + j] = p[j];
+          switch (r) {
+          case 1:
+            hl = vextq_f32(hl, x.val[0], 1);
+            hr = vextq_f32(hr, x.val[1], 1);
+            break;
+          case 2:
+            hl = vextq_f32(hl, x.val[0], 2);
+            hr = vextq_f32(hr, x.val[1], 2);
+            break;
+          default:
+            hl = vextq_f32(hl, x.val[0], 3);
+            hr = vextq_f32(hr, x.val[1], 3);
+            break;
+          }
+        }
+        mHistL = hl;
+        mHistR = hr;
+      }
+
+      // Sliding window maximum over lookahead window
+      {
+        const uint32_t window = mWindow;
+        uint32_t head = mDqHead;
+        uint32_t tail = mDqTail;
+        uint32_t count = mCount;
+        for (size_t i = 0; i < frames; ++i, ++count) {
+          const float v = peak[i];
+          while (tail != head && mDqVal[(tail - 1) & k_buffer_mask] <= v)
+            --tail;
+          mDqVal[tail & k_buffer_mask] = v;
+          mDqIdx[tail & k_buffer_mask] = count;
+          ++tail;
+          if (count - mDqIdx[head & k_buffer_mask] >= window)
+            ++head;
+          peak[i] = mDqVal[head & k_buffer_mask];
+        }
+        mDqHead = head;
+        mDqTail = tail;
+        mCount = count;
+      }
+
+      // Gain computer in log2 domain, with soft knee
+      {
+        const size_t padded = (frames + 3) & ~(size_t)3;
+        for (size_t i = frames; i < padded; ++i)
+          peak[i] = 0.f;
+
+        const float32x4_t threshold = vdupq_n_f32(mThreshold);
+        const float32x4_t half_knee = vdupq_n_f32(0.5f * mKnee);
+        const float32x4_t neg_half_knee = vdupq_n_f32(-0.5f * mKnee);
+        const float slope = mSlope;
+        const float knee_scale = (mKnee > 0.f) ? 0.5f * slope / mKnee : 0.f;
+        const float32x4_t zero = vdupq_n_f32(0.f);
+        const float32x4_t floor = vdupq_n_f32(1e-9f);
+
+        for (size_t i = 0; i < padded; i += 4) {
+          const float32x4_t x = vlog2q(vmaxq_f32(vld1q_f32(peak + i), floor));
+          const float32x4_t over = vsubq_f32(x, threshold);
+          const float32x4_t q = vaddq_f32(over, half_knee);
+          const float32x4_t g_knee = vmulq_n_f32(vmulq_f32(q, q), knee_scale);
+          const float32x4_t g_above = vmulq_n_f32(over, slope);
+          float32x4_t g = vbslq_f32(vcgtq_f32(over, half_knee), g_above, g_knee);
+          g = vbslq_f32(vcltq_f32(over, neg_half_knee), zero, g);
+          vst1q_f32(gain + i, vexp2q(g));
+        }
+      }
+
+      // Release smoothing, then moving average over lookahead window
+      {
+        const uint32_t window = mWindow;
+        const float release = mReleaseCoef;
+        const float box_scale = mBoxScale;
+        float env = mEnv;
+        uint32_t sum = mBoxSum;
+        uint32_t pos = mBoxPos;
+        for (size_t i = 0; i < frames; ++i) {
+          const float g = gain[i];
+          env = (g < env) ? g : g + (env - g) * release;
+          const uint32_t q = (uint32_t)(env * k_gain_one);
+          sum += q - mBox[pos];
+          mBox[pos] = q;
+          if (++pos == window)
+            pos = 0;
+          gain[i] = sum * box_scale;
+        }
+        mEnv = env;
+        mBoxSum = sum;
+        mBoxPos = pos;
+      }
+
+      // Apply gain to delayed input
+      {
+        const uint32_t latency = mWindow + 1;
+        const float makeup = mMakeup;
+        uint32_t wpos = mWritePos;
+        for (size_t i = 0; i < frames; ++i) {
+          vst1_f32(mDelay + 2 * wpos, vld1_f32(in + 2 * i));
+          const float32x2_t d = vld1_f32(mDelay + 2 * ((wpos - latency) & k_buffer_mask));
+          vst1_f32(out + 2 * i, vmul_n_f32(d, gain[i] * makeup));
+          wpos = (wpos + 1) & k_buffer_mask;
+        }
+        mWritePos = wpos;
+        mGain = gain[frames - 1];
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float32x4_t mHistL;
+    float32x4_t mHistR;
+
+    float    mFs;
+    float    mThreshold;
+    float    mKnee;
+    float    mSlope;
+    float    mMakeup;
+    float    mReleaseCoef;
+    float    mBoxScale;
+    float    mEnv;
+    float    mGain;
+
+    uint32_t mWindow;
+    uint32_t mWritePos;
+    uint32_t mDqHead;
+    uint32_t mDqTail;
+    uint32_t mCount;
+    uint32_t mBoxSum;
+    uint32_t mBoxPos;
+
+    float    mDqVal[k_buffer_size];
+    uint32_t mDqIdx[k_buffer_size];
+    uint32_t mBox[k_buffer_size];
+    float    mDelay[2 * k_buffer_size];
+  };
+
+}
@@ -0,0 +1,276 @@
+#pragma once
+/**
+ * @file convolver.hpp
+ * @brief Uniformly partitioned FFT convolution
+ *
+ * Copyright (c) 2020-2022 KORG Inc. All rights reserved.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include <arm_neon.h>
+
+#include "dsp/fft.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Single channel uniformly partitioned overlap-save convolution.
+   *
+   * The impulse response is split in partitions of B samples, each zero padded to
+   * 2B and transformed once when loaded. Every B input samples the last 2B inputs
+   * are transformed and pushed on a frequency-domain delay line, then multiplied
+   * with the partition spectra and accumulated, so that a single inverse transform
+   * gives the next B output samples.
+   *
+   * Latency is B samples, B being best matched to the audio buffer size so that
+   * each block runs exactly one partition. Cost per sample is one complex
+   * multiply-accumulate per partition, i.e. grows linearly with impulse length.
+   * The multiply-accumulate is vectorized with NEON over four bins at a time.
+   *
+   * Impulse spectra are held in a separate Spectra structure, filled with prepare()
+   * outside of the audio path and swapped in with setSpectra().
+   *
+   * @tparam PartExp log2 of partition size B, in [5, 11]
+   * @tparam MaxParts Maximum number of partitions, i.e. impulse length in units of B
+   */
+  template <uint32_t PartExp, uint32_t MaxParts>
+  struct PartitionedConvolver {
+
+    static_assert(PartExp >= 5 && PartExp <= 11, "Partition size must be 32 to 2048");
+    static_assert(MaxParts > 0, "At least one partition required");
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    typedef RealFFT<PartExp + 1> FFT;
+
+    enum {
+      k_partition_size = 1U << PartExp,       /**< Partition size B. */
+      k_spectrum_size = 2U << PartExp,        /**< Floats per packed partition spectrum. */
+      k_max_partitions = MaxParts,            /**< Maximum number of partitions. */
+      k_max_frames = MaxParts << PartExp,     /**< Maximum impulse length. */
+    };
+
+    /**
+     * Precomputed impulse response partition spectra.
+     */
+    struct Spectra {
+      float    mBins[MaxParts * k_spectrum_size] __attribute__((aligned(16)));
+      uint32_t mPartitions;
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    PartitionedConvolver(void) :
+      mSpectra(nullptr),
+      mPartitions(MaxParts)
+    {
+      reset();
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Clear input history and pending output.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void reset(void) {
+      for (uint32_t i = 0; i < MaxParts * k_spectrum_size; ++i)
+        mDelayLine[i] = 0.f;
+      for (uint32_t i = 0; i < k_spectrum_size; ++i)
+        mInput[i] = 0.f;
+      for (uint32_t i = 0; i < k_partition_size; ++i)
+        mOutput[i] = 0.f;
+      mHead = 0;
+      mPos = 0;
+    }
+
+    /**
+     * Compute partition spectra of an impulse response.
+     *
+     * @param dst Destination spectra, must not be in use by process()
+     * @param ir First sample of impulse response
+     * @param frames Impulse length in samples, truncated to k_max_frames
+     * @param stride Distance between consecutive samples in ir, e.g.: channel count
+     * @param gain Gain applied to impulse response
+     *
+     * @note Runs one forward transform per partition, should not be called from the audio loop.
+     *       Only reads the shared twiddle tables, so may run concurrently with process().
+     */
+    inline __attribute__((optimize("Ofast")))
+    void prepare(Spectra & dst, const float * ir, size_t frames, size_t stride, const float gain) {
+      if (frames > k_max_frames)
+        frames = k_max_frames;
+
+      const uint32_t parts = (uint32_t)((frames + k_partition_size - 1) >> PartExp);
+      for (uint32_t p = 0; p < parts; ++p) {
+        float * x = dst.mBins + p * k_spectrum_size;
+        const size_t remain = frames - ((size_t)p << PartExp);
+        const uint32_t n = (remain < k_partition_size) ? (uint32_t)remain : (uint32_t)k_partition_size;
+        const float * src = ir + ((size_t)p << PartExp) * stride;
+        uint32_t i = 0;
+        for (; i < n; ++i)
+          x[i] = gain * src[i * stride];
+        for (; i < k_spectrum_size; ++i)
+          x[i] = 0.f;
+        mFFT.forward(x);
+      }
+      dst.mPartitions = parts;
+    }
+
+    /**
+     * Set impulse spectra to convolve with.
+     *
+     * @param spectra Prepared spectra, or nullptr for silent output
+     *
+     * @note Takes effect on the next partition, input history is kept.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setSpectra(const Spectra * spectra) {
+      mSpectra = spectra;
+    }
+
+    /**
+     * Limit number of partitions used, truncating the impulse response.
+     *
+     * @param parts Partition count, clipped to [1, k_max_partitions]
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setPartitions(uint32_t parts) {
+      mPartitions = (parts < 1) ? 1 : (parts > MaxParts) ? (uint32_t)MaxParts : parts;
+    }
+
+    /**
+     * Get latency in samples between input and convolved output.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    uint32_t getLatency(void) const {
+      return k_partition_size;
+    }
+
+    /**
+     * Process a block of samples.
+     *
+     * @param in Input samples
+     * @param out Output samples, may be the same as in
+     * @param frames Number of samples to process
+     * @param stride Distance between consecutive samples in in and out, e.g.: 2 for one channel of interleaved stereo
+     */
+    inline __attribute__((optimize("Ofast")))
+    void process(const float * in, float * out, size_t frames, const size_t stride = 1) {
+      while (frames) {
+        const uint32_t n = (frames < (size_t)(k_partition_size - mPos)) ? (uint32_t)frames : (uint32_t)(k_partition_size - mPos);
+
+        float * input = mInput + k_partition_size + mPos;
+        const float * output = mOutput + mPos;
+        for (uint32_t i = 0; i < n; ++i) {
+          const float x = in[i * stride];
+          out[i * stride] = output[i];
+          input[i] = x;
+        }
+        in += n * stride;
+        out += n * stride;
+        frames -= n;
+        mPos += n;
+
+        if (mPos == k_partition_size) {
+          runPartition();
+          mPos = 0;
+        }
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    FFT             mFFT;
+    float           mDelayLine[MaxParts * k_spectrum_size] __attribute__((aligned(16)));
+    float           mInput[k_spectrum_size] __attribute__((aligned(16)));
+    float           mOutput[k_partition_size] __attribute__((aligned(16)));
+    const Spectra * mSpectra;
+    uint32_t        mPartitions;
+    uint32_t        mHead;
+    uint32_t        mPos;
+
+  private:
+
+    /**
+     * Transform last 2B inputs onto the delay line and compute the next B outputs.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void runPartition(void) {
+      float * x = mDelayLine + mHead * k_spectrum_size;
+      for (uint32_t i = 0; i < k_spectrum_size; i += 4)
+        vst1q_f32(x + i, vld1q_f32(mInput + i));
+      for (uint32_t i = 0; i < k_partition_size; i += 4)
+        vst1q_f32(mInput + i, vld1q_f32(mInput + k_partition_size + i));
+      mFFT.forward(x);
+
+      float acc[k_spectrum_size] __attribute__((aligned(16)));
+      for (uint32_t i = 0; i < k_spectrum_size; i += 4)
+        vst1q_f32(acc + i, vdupq_n_f32(0.f));
+
+      const Spectra * spectra = mSpectra;
+      if (spectra) {
+        const uint32_t parts = (mPartitions < spectra->mPartitions) ? mPartitions : spectra->mPartitions;
+        float dc = 0.f, nyquist = 0.f;
+        uint32_t slot = mHead;
+        for (uint32_t p = 0; p < parts; ++p) {
+          const float * xp = mDelayLine + slot * k_spectrum_size;
+          const float * hp = spectra->mBins + p * k_spectrum_size;
+          // Real valued DC and Nyquist bins share the first pair
+          dc += xp[0] * hp[0];
+          nyquist += xp[1] * hp[1];
+          multiplyAccumulate(acc, xp, hp);
+          slot = slot ? slot - 1 : MaxParts - 1;
+        }
+        acc[0] = dc;
+        acc[1] = nyquist;
+      }
+
+      mFFT.inverse(acc);
+
+      // Overlap-save, first half is circular aliasing
+      for (uint32_t i = 0; i < k_partition_size; i += 4)
+        vst1q_f32(mOutput + i, vld1q_f32(acc + k_partition_size + i));
+
+      mHead = (mHead + 1 < MaxParts) ? mHead + 1 : 0;
+    }
+
+    /**
+     * Complex multiply-accumulate of packed spectra, acc += x * h.
+     *
+     * @note First pair is processed as a complex bin too and must be fixed up by the caller.
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    void multiplyAccumulate(float * acc, const float * x, const float * h) {
+      for (uint32_t i = 0; i < k_spectrum_size; i += 8) {
+        const float32x4x2_t xv = vld2q_f32(x + i);
+        const float32x4x2_t hv = vld2q_f32(h + i);
+        float32x4x2_t av = vld2q_f32(acc + i);
+        av.val[0] = vmlaq_f32(av.val[0], xv.val[0], hv.val[0]);
+        av.val[0] = vmlsq_f32(av.val[0], xv.val[1], hv.val[1]);
+        av.val[1] = vmlaq_f32(av.val[1], xv.val[0], hv.val[1]);
+        av.val[1] = vmlaq_f32(av.val[1], xv.val[1], hv.val[0]);
+        vst2q_f32(acc + i, av);
+      }
+    }
+
+  };
+
+}
@@ -0,0 +1,422 @@
+#pragma once
+/**
+ * @file envelope.hpp
+ * @brief Exponential ADSR/AHD envelope generator
+ *
+ * Copyright (c) 2020-2022 KORG Inc. All rights reserved.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * ADSR/AHD envelope generator with exponential segments.
+   *
+   * Each segment approaches a target placed slightly beyond its end level, so that
+   * every sample is a single multiply-add: level = target + (level - target) * coef.
+   * Coefficients and segment lengths are only computed when entering a stage or
+   * when a parameter of the current stage changes.
+   *
+   * In AHD mode the envelope is a one-shot, gate off is ignored and decay ends at zero.
+   */
+  struct Envelope {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_stage_idle = 0,
+      k_stage_attack,
+      k_stage_hold,
+      k_stage_decay,
+      k_stage_sustain,
+      k_stage_release,
+      k_num_stages
+    };
+
+    enum {
+      k_mode_adsr = 0,
+      k_mode_ahd,
+      k_num_modes
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    Envelope(void) :
+      mLevel(0.f),
+      mTarget(0.f),
+      mCoef(0.f),
+      mRemain(k_infinite),
+      mStage(k_stage_idle),
+      mMode(k_mode_adsr),
+      mFs(48000.f),
+      mAttack(0.001f),
+      mHold(0.f),
+      mDecay(0.1f),
+      mSustain(1.f),
+      mRelease(0.1f)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set sampling rate
+     *
+     * @param fs Sampling rate in Hz
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setSamplingRate(const float fs) {
+      mFs = fs;
+    }
+
+    /**
+     * Set envelope mode
+     *
+     * @param mode k_mode_adsr or k_mode_ahd
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMode(const uint32_t mode) {
+      mMode = (mode < k_num_modes) ? mode : (uint32_t)k_mode_adsr;
+    }
+
+    /**
+     * Set attack time
+     *
+     * @param t Time in seconds to reach peak level from current level
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setAttack(const float t) {
+      mAttack = t;
+      if (mStage == k_stage_attack)
+        enterStage(k_stage_attack);
+    }
+
+    /**
+     * Set hold time, time spent at peak level before decay
+     *
+     * @param t Time in seconds
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setHold(const float t) {
+      mHold = t;
+    }
+
+    /**
+     * Set decay time
+     *
+     * @param t Time in seconds to reach sustain level (ADSR) or zero (AHD) from peak level
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDecay(const float t) {
+      mDecay = t;
+      if (mStage == k_stage_decay || mStage == k_stage_sustain)
+        enterStage(mStage);
+    }
+
+    /**
+     * Set sustain level, ignored in AHD mode
+     *
+     * @param level Level in [0, 1]
+     *
+     * @note While sustaining, level glides to the new value at decay rate.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setSustain(const float level) {
+      mSustain = (level < 0.f) ? 0.f : (level > 1.f) ? 1.f : level;
+      if (mStage == k_stage_decay || mStage == k_stage_sustain)
+        enterStage(mStage);
+    }
+
+    /**
+     * Set release time
+     *
+     * @param t Time in seconds to reach zero from current level
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setRelease(const float t) {
+      mRelease = t;
+      if (mStage == k_stage_release)
+        enterStage(k_stage_release);
+    }
+
+    /**
+     * Return to idle state with zero level
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void reset(void) {
+      mLevel = 0.f;
+      enterStage(k_stage_idle);
+    }
+
+    /**
+     * Start attack from current level
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void gateOn(void) {
+      enterStage(k_stage_attack);
+    }
+
+    /**
+     * Start release from current level, ignored in AHD mode
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void gateOff(void) {
+      if (mMode == k_mode_adsr && mStage != k_stage_idle)
+        enterStage(k_stage_release);
+    }
+
+    /**
+     * Get current level
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float getLevel(void) const {
+      return mLevel;
+    }
+
+    /**
+     * Get current stage
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    uint32_t getStage(void) const {
+      return mStage;
+    }
+
+    /**
+     * Check whether envelope has reached idle state
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    bool isIdle(void) const {
+      return mStage == k_stage_idle;
+    }
+
+    /**
+     * Compute next envelope value
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float process(void) {
+      const float level = mTarget + (mLevel - mTarget) * mCoef;
+      mLevel = level;
+      if (mRemain != k_infinite && --mRemain == 0)
+        nextStage();
+      return level;
+    }
+
+    /**
+     * Fill a block with envelope values
+     *
+     * @param out Destination buffer
+     * @param frames Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(float * __restrict out, size_t frames) {
+      while (frames) {
+        const size_t n = (mRemain < frames) ? mRemain : frames;
+        const float target = mTarget;
+        const float coef = mCoef;
+        float level = mLevel;
+        for (size_t i = 0; i < n; ++i) {
+          level = target + (level - target) * coef;
+          out[i] = level;
+        }
+        mLevel = level;
+        out += n;
+        frames -= n;
+        if (mRemain != k_infinite && (mRemain -= n) == 0)
+          nextStage();
+      }
+    }
+
+    /**
+     * Fill a block with envelope values, changing gate state at a given offset
+     *
+     * @param out Destination buffer
+     * @param frames Number of values to write
+     * @param offset Offset in samples from start of block at which the gate changes
+     * @param gate New gate state
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(float * __restrict out, size_t frames, size_t offset, bool gate) {
+      if (offset > frames)
+        offset = frames;
+      process(out, offset);
+      if (gate)
+        gateOn();
+      else
+        gateOff();
+      process(out + offset, frames - offset);
+    }
+
+  private:
+
+    /*===========================================================================*/
+    /* Private Methods.                                                          */
+    /*===========================================================================*/
+
+    enum {
+      k_infinite = 0xFFFFFFFF
+    };
+
+    /**
+     * Overshoot of exponential targets, relative to segment height
+     */
+    static inline __attribute__((always_inline))
+    float attackRatio(void) { return 0.3f; }
+
+    static inline __attribute__((always_inline))
+    float decayRatio(void) { return 0.001f; }
+
+    /**
+     * exp(-x) for x >= 0, accurate for the tiny arguments of long segments
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float expneg(const float x) {
+      // Taylor series on x/256, then squared 8 times
+      const float y = x * (1.f / 256.f);
+      float e = 1.f - y * (1.f - 0.5f * y * (1.f - (1.f / 3.f) * y * (1.f - 0.25f * y)));
+      for (int i = 0; i < 8; ++i)
+        e *= e;
+      return e;
+    }
+
+    /**
+     * Approximate natural logarithm for x > 0, only used for segment lengths
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float approxlogf(const float x) {
+      union { float f; uint32_t i; } vx = { x };
+      union { uint32_t i; float f; } mx = { (vx.i & 0x007FFFFF) | 0x3f000000 };
+      const float y = vx.i * 1.1920928955078125e-7f;
+      return 0.69314718f * (y - 124.22551499f - 1.498030302f * mx.f - 1.72587999f / (0.3520887068f + mx.f));
+    }
+
+    /**
+     * Configure segment from current level toward end level
+     *
+     * @param end Level at which segment ends
+     * @param overshoot Distance of exponential target beyond end level, signed
+     * @param ratio Overshoot relative to nominal segment height
+     * @param time Nominal segment time in seconds
+     *
+     * @return True if segment is not already complete
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    bool setSegment(const float end, const float overshoot, const float ratio, const float time) {
+      const float samples = time * mFs;
+      const float target = end + overshoot;
+      const float dist = (mLevel - target) / (end - target);
+      if (samples < 1.f || !(dist > 1.f)) {
+        mLevel = (samples < 1.f) ? end : mLevel;
+        return false;
+      }
+      const float rate = approxlogf((1.f + ratio) / ratio) / samples;
+      mTarget = target;
+      mCoef = expneg(rate);
+      const float n = approxlogf(dist) / rate;
+      mRemain = (n < 1.f) ? 1 : (n > 0x7FFFFFFF) ? 0x7FFFFFFF : (uint32_t)n;
+      return true;
+    }
+
+    inline __attribute__((optimize("Ofast")))
+    void enterStage(const uint32_t stage) {
+      mStage = stage;
+      switch (stage) {
+      case k_stage_attack:
+        if (setSegment(1.f, attackRatio(), attackRatio(), mAttack))
+          return;
+        mLevel = 1.f;
+        break;
+      case k_stage_hold:
+        mTarget = mLevel;
+        mCoef = 1.f;
+        {
+          const float n = mHold * mFs;
+          if (n >= 1.f) {
+            mRemain = (n > 0x7FFFFFFF) ? 0x7FFFFFFF : (uint32_t)n;
+            return;
+          }
+        }
+        break;
+      case k_stage_decay:
+        {
+          const float end = (mMode == k_mode_ahd) ? 0.f : mSustain;
+          const float height = (mLevel > end) ? mLevel - end : 0.f;
+          if (setSegment(end, -decayRatio() * height, decayRatio(), mDecay))
+            return;
+          mLevel = end;
+        }
+        break;
+      case k_stage_sustain:
+        {
+          const float samples = mDecay * mFs;
+          mTarget = mSustain;
+          mCoef = (samples < 1.f) ? 0.f : expneg(approxlogf((1.f + decayRatio()) / decayRatio()) / samples);
+          mRemain = k_infinite;
+        }
+        return;
+      case k_stage_release:
+        if (setSegment(0.f, -decayRatio() * mLevel, decayRatio(), mRelease))
+          return;
+        mLevel = 0.f;
+        break;
+      default:
+        mStage = k_stage_idle;
+        mLevel = 0.f;
+        mTarget = 0.f;
+        mCoef = 0.f;
+        mRemain = k_infinite;
+        return;
+      }
+      nextStage();
+    }
+
+    inline __attribute__((optimize("Ofast")))
+    void nextStage(void) {
+      switch (mStage) {
+      case k_stage_attack:
+        mLevel = 1.f;
+        enterStage(k_stage_hold);
+        break;
+      case k_stage_hold:
+        enterStage(k_stage_decay);
+        break;
+      case k_stage_decay:
+        enterStage((mMode == k_mode_ahd) ? (uint32_t)k_stage_idle : (uint32_t)k_stage_sustain);
+        break;
+      default:
+        enterStage(k_stage_idle);
+        break;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float    mLevel;
+    float    mTarget;
+    float    mCoef;
+    uint32_t mRemain;
+    uint32_t mStage;
+    uint32_t mMode;
+    float    mFs;
+    float    mAttack;
+    float    mHold;
+    float    mDecay;
+    float    mSustain;
+    float    mRelease;
+  };
+}
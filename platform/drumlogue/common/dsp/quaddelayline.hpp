@@ -0,0 +1,215 @@
+#pragma once
+/**
+ * @file quaddelayline.hpp
+ * @brief Four lane interleaved delay line
+ *
+ * Copyright (c) 2020-2022 KORG Inc. All rights reserved.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include <arm_neon.h>
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Four delay lines with interleaved samples, one float32x4_t frame per time step.
+   *
+   * All four lanes are written and read with a single vector load/store, fractional
+   * reads are interpolated lane-parallel.
+   */
+  struct QuadDelayLine {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    QuadDelayLine(void) :
+      mLine(0),
+      mSize(0),
+      mMask(0),
+      mWriteIdx(0)
+    { }
+
+    /**
+     * Constructor with explicit memory area to use as backing buffer for delay line.
+     *
+     * @param ram Pointer to memory buffer
+     * @param line_size Size in frames of memory buffer
+     */
+    QuadDelayLine(float32x4_t *ram, size_t line_size) :
+      mWriteIdx(0)
+    {
+      setMemory(ram, line_size);
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Zero clear the whole delay line.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void clear(void) {
+      const float32x4_t zero = vdupq_n_f32(0.f);
+      for (size_t i = 0; i < mSize; ++i)
+        vst1q_f32((float *)(mLine + i), zero);
+    }
+
+    /**
+     * Set the memory area to use as backing buffer for the delay line.
+     *
+     * @param ram Pointer to memory buffer
+     * @param line_size Size in frames of memory buffer
+     *
+     * @note Will round size down to a power of two so that it fits in the buffer.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMemory(float32x4_t *ram, size_t line_size) {
+      mLine = ram;
+      mSize = line_size ? (1U << (31 - __builtin_clz((uint32_t)line_size))) : 0;
+      mMask = mSize ? (mSize - 1) : 0;
+      mWriteIdx = 0;
+    }
+
+    /**
+     * Write a frame to the head of the delay line
+     *
+     * @param v Frame holding one sample per lane
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void write(const float32x4_t v) {
+      vst1q_f32((float *)(mLine + ((mWriteIdx--) & mMask)), v);
+    }
+
+    /**
+     * Read a frame from the delay line at given position from current write index.
+     *
+     * @param pos Offset from write index
+     * @return Frame at given position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float32x4_t read(const uint32_t pos) {
+      return vld1q_f32((const float *)(mLine + ((mWriteIdx + pos) & mMask)));
+    }
+
+    /**
+     * Read a frame from the delay line at a fractional position common to all lanes.
+     *
+     * @param pos Offset from write index as floating point.
+     * @return Interpolated frame at given fractional position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float32x4_t readFrac(const float pos) {
+      const uint32_t base = (uint32_t)pos;
+      const float frac = pos - base;
+      const float32x4_t s0 = read(base);
+      const float32x4_t s1 = read(base+1);
+      return vmlaq_n_f32(s0, vsubq_f32(s1, s0), frac);
+    }
+
+    /**
+     * Read a frame from the delay line with an independent fractional position per lane.
+     *
+     * @param pos Offsets from write index as floating point, one per lane.
+     * @return Frame with each lane interpolated at its own position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float32x4_t readFrac(const float32x4_t pos) {
+      const uint32x4_t base = vcvtq_u32_f32(pos);
+      const float32x4_t frac = vsubq_f32(pos, vcvtq_f32_u32(base));
+      const uint32x4_t idx = vaddq_u32(base, vdupq_n_u32(mWriteIdx));
+
+      float32x4_t s0 = vdupq_n_f32(0.f);
+      float32x4_t s1 = vdupq_n_f32(0.f);
+      gather(idx, &s0, &s1);
+
+      return vmlaq_f32(s0, vsubq_f32(s1, s0), frac);
+    }
+
+    /**
+     * Read a frame from the delay line with an independent fractional position per lane, using 4-point Hermite interpolation.
+     *
+     * @param pos Offsets from write index as floating point, one per lane, should be >= 2.
+     * @return Frame with each lane interpolated at its own position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float32x4_t readFracHermite(const float32x4_t pos) {
+      const uint32x4_t base = vcvtq_u32_f32(pos);
+      const float32x4_t frac = vsubq_f32(pos, vcvtq_f32_u32(base));
+      const uint32x4_t idx = vaddq_u32(base, vdupq_n_u32(mWriteIdx - 1));
+
+      float32x4_t xm1 = vdupq_n_f32(0.f);
+      float32x4_t x0 = vdupq_n_f32(0.f);
+      float32x4_t x1 = vdupq_n_f32(0.f);
+      float32x4_t x2 = vdupq_n_f32(0.f);
+      gather(idx, &xm1, &x0);
+      gather(vaddq_u32(idx, vdupq_n_u32(2)), &x1, &x2);
+
+      // c1 = (x1 - xm1) / 2
+      // c2 = xm1 - 5/2 x0 + 2 x1 - x2 / 2
+      // c3 = (x2 - xm1) / 2 + 3/2 (x0 - x1)
+      const float32x4_t c1 = vmulq_n_f32(vsubq_f32(x1, xm1), 0.5f);
+      float32x4_t c2 = vmlsq_n_f32(xm1, x0, 2.5f);
+      c2 = vmlaq_n_f32(c2, x1, 2.f);
+      c2 = vmlsq_n_f32(c2, x2, 0.5f);
+      float32x4_t c3 = vmulq_n_f32(vsubq_f32(x2, xm1), 0.5f);
+      c3 = vmlaq_n_f32(c3, vsubq_f32(x0, x1), 1.5f);
+
+      float32x4_t y = vmlaq_f32(c2, c3, frac);
+      y = vmlaq_f32(c1, y, frac);
+      return vmlaq_f32(x0, y, frac);
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float32x4_t *mLine;
+    size_t       mSize;
+    size_t       mMask;
+    uint32_t     mWriteIdx;
+
+  private:
+
+    /**
+     * Gather each lane's own sample from two consecutive frames.
+     *
+     * @param idx Raw frame index per lane, will be masked
+     * @param s0 Destination for lane samples at idx
+     * @param s1 Destination for lane samples at idx+1
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void gather(const uint32x4_t idx, float32x4_t *s0, float32x4_t *s1) {
+      const float *line = (const float *)mLine;
+      const uint32_t mask = mMask;
+      const uint32_t i0 = vgetq_lane_u32(idx, 0);
+      const uint32_t i1 = vgetq_lane_u32(idx, 1);
+      const uint32_t i2 = vgetq_lane_u32(idx, 2);
+      const uint32_t i3 = vgetq_lane_u32(idx, 3);
+      *s0 = vld1q_lane_f32(line + 4 * (i0 & mask) + 0, *s0, 0);
+      *s0 = vld1q_lane_f32(line + 4 * (i1 & mask) + 1, *s0, 1);
+      *s0 = vld1q_lane_f32(line + 4 * (i2 & mask) + 2, *s0, 2);
+      *s0 = vld1q_lane_f32(line + 4 * (i3 & mask) + 3, *s0, 3);
+      *s1 = vld1q_lane_f32(line + 4 * ((i0 + 1) & mask) + 0, *s1, 0);
+      *s1 = vld1q_lane_f32(line + 4 * ((i1 + 1) & mask) + 1, *s1, 1);
+      *s1 = vld1q_lane_f32(line + 4 * ((i2 + 1) & mask) + 2, *s1, 2);
+      *s1 = vld1q_lane_f32(line + 4 * ((i3 + 1) & mask) + 3, *s1, 3);
+    }
+
+  };
+
+}
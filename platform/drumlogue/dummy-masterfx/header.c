@@ -26,21 +26,14 @@ const __unit_header unit_header_t unit_header = {
         // See common/runtime.h for type enum and unit_param_t structure
 
         // Page 1
-        // percent param with .5 precision e.g.: "25.0%", "50.5%"
-        {0, (100 << 1), 0, (25 << 1), k_unit_param_type_percent, 1, 0, 0, {"PARAM1"}},
-        // untyped bipolar parameter centered at 0 e.g.: "-5", "0", "2"
-        {-5, 5, 0, 0, k_unit_param_type_none, 0, 0, 0, {"PARAM2"}},
-        // pan parameter e.g.: "L50", "C", "R100"
-        {-100, 100, 0, 0, k_unit_param_type_pan, 0, 0, 0, {"PARAM3"}},
-        // blank parameter, leaves that parameter slot blank in UI. Use when want to align some params to next page
-        {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
+        {-400, 0, 0, -10, k_unit_param_type_db, 1, 1, 0, {"THRESH"}},
+        {0, 8, 0, 8, k_unit_param_type_strings, 0, 0, 0, {"RATIO"}},
+        {0, 120, 0, 20, k_unit_param_type_db, 1, 1, 0, {"KNEE"}},
+        {0, 240, 0, 0, k_unit_param_type_db, 1, 1, 0, {"MAKEUP"}},
 
         // Page 2
-        // string enum parameter, unit_get_param_str_value will be called with numerical value to obtain string to display
-        {0, 9, 0, 0, k_unit_param_type_strings, 0, 0, 0, {"PARAM4"}},
-        // bitmap enum parameter, unit_get_param_bmp_value will be called with numerical value to obtain the bitmap to display
-        // Note: bitmap specifications not final yet, and not implemented yet in UI
-        {0, 9, 0, 0, k_unit_param_type_bitmaps, 0, 0, 0, {"PARAM5"}},
+        {1, 100, 0, 15, k_unit_param_type_msec, 1, 1, 0, {"ATTACK"}},
+        {10, 1000, 0, 100, k_unit_param_type_msec, 0, 0, 0, {"RELEASE"}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
 
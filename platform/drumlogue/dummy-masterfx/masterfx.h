@@ -18,17 +18,72 @@
 
 #include "unit.h"  // Note: Include common definitions for all units
 
+#include "dsp/compressor.hpp"
+
 class MasterFX {
  public:
   /*===========================================================================*/
   /* Public Data Structures/Types. */
   /*===========================================================================*/
 
+  enum {
+    THRESH = 0U,
+    RATIO,
+    KNEE,
+    MAKEUP,
+    ATTACK,
+    RELEASE,
+    NUM_PARAMS
+  };
+
+  enum {
+    RATIO_1_5 = 0,
+    RATIO_2,
+    RATIO_3,
+    RATIO_4,
+    RATIO_6,
+    RATIO_8,
+    RATIO_12,
+    RATIO_20,
+    RATIO_LIMIT,
+    NUM_RATIO_VALUES,
+  };
+
+  // Note: raw parameter values, as described in header.c
+  struct Params {
+    int32_t thresh{-10};
+    int32_t ratio{RATIO_LIMIT};
+    int32_t knee{20};
+    int32_t makeup{0};
+    int32_t attack{15};
+    int32_t release{100};
+
+    void reset() {
+      thresh = -10;
+      ratio = RATIO_LIMIT;
+      knee = 20;
+      makeup = 0;
+      attack = 15;
+      release = 100;
+    }
+  };
+
+  enum {
+    k_flags_none    = 0,
+    k_flag_thresh   = 1<<0,
+    k_flag_ratio    = 1<<1,
+    k_flag_knee     = 1<<2,
+    k_flag_makeup   = 1<<3,
+    k_flag_attack   = 1<<4,
+    k_flag_release  = 1<<5,
+    k_flags_all     = k_flag_thresh | k_flag_ratio | k_flag_knee | k_flag_makeup | k_flag_attack | k_flag_release,
+  };
+
   /*===========================================================================*/
   /* Lifecycle Methods. */
   /*===========================================================================*/
 
-  MasterFX(void) {}
+  MasterFX(void) : flags_(k_flags_none) {}
   virtual ~MasterFX(void) {}
 
   inline int8_t Init(const unit_runtime_desc_t * desc) {
@@ -43,7 +98,12 @@ class MasterFX {
     if (desc->input_channels != 4 || desc->output_channels != 2)
       return k_unit_err_geometry;
 
-    // Note: if need to allocate some memory can do it here and return k_unit_err_memory if getting allocation errors
+    comp_.setSamplingRate(desc->samplerate);
+
+    params_.reset();
+    updateCompressor(k_flags_all);
+    flags_ = k_flags_none;
+    comp_.reset();
 
     return k_unit_err_none;
   }
@@ -54,6 +114,7 @@ class MasterFX {
 
   inline void Reset() {
     // Note: Reset effect state.
+    comp_.reset();
   }
 
   inline void Resume() {
@@ -71,20 +132,55 @@ class MasterFX {
   /*===========================================================================*/
 
   fast_inline void Process(const float * in, float * out, size_t frames) {
+    const uint32_t flags = flags_.exchange(k_flags_none, std::memory_order_relaxed);
+    if (flags)
+      updateCompressor(flags);
+
+    // Note: main input pair is extracted from [main_left, main_right, sidechain_left, sidechain_right]
+    //       into output buffer, and then compressed in place
     const float * __restrict in_p = in;
     float * __restrict out_p = out;
     const float * out_e = out_p + (frames << 1);  // assuming stereo output
 
     for (; out_p != out_e; in_p += 4, out_p += 2) {
-      // Note: should take advantage of NEON ArmV7 instructions
       float32x4_t sig = vld1q_f32(in_p);
       vst1_f32(out_p, vget_low_f32(sig));
     }
+
+    comp_.process(out, out, frames);
   }
 
   inline void setParameter(uint8_t index, int32_t value) {
-    (void)value;
     switch (index) {
+      case THRESH:
+        // -40.0 .. 0.0 dB, 1 decimal
+        params_.thresh = clip(value, -400, 0);
+        flags_.fetch_or(k_flag_thresh);
+        break;
+      case RATIO:
+        params_.ratio = clip(value, RATIO_1_5, NUM_RATIO_VALUES - 1);
+        flags_.fetch_or(k_flag_ratio);
+        break;
+      case KNEE:
+        // 0.0 .. 12.0 dB, 1 decimal
+        params_.knee = clip(value, 0, 120);
+        flags_.fetch_or(k_flag_knee);
+        break;
+      case MAKEUP:
+        // 0.0 .. 24.0 dB, 1 decimal
+        params_.makeup = clip(value, 0, 240);
+        flags_.fetch_or(k_flag_makeup);
+        break;
+      case ATTACK:
+        // 0.1 .. 10.0 ms, 1 decimal
+        params_.attack = clip(value, 1, 100);
+        flags_.fetch_or(k_flag_attack);
+        break;
+      case RELEASE:
+        // 10 .. 1000 ms
+        params_.release = clip(value, 10, 1000);
+        flags_.fetch_or(k_flag_release);
+        break;
       default:
         break;
     }
@@ -92,6 +188,18 @@ class MasterFX {
 
   inline int32_t getParameterValue(uint8_t index) const {
     switch (index) {
+      case THRESH:
+        return params_.thresh;
+      case RATIO:
+        return params_.ratio;
+      case KNEE:
+        return params_.knee;
+      case MAKEUP:
+        return params_.makeup;
+      case ATTACK:
+        return params_.attack;
+      case RELEASE:
+        return params_.release;
       default:
         break;
     }
@@ -99,11 +207,26 @@ class MasterFX {
   }
 
   inline const char * getParameterStrValue(uint8_t index, int32_t value) const {
-    (void)value;
+    // Note: String memory must be accessible even after function returned.
+    //       It can be assumed that caller will have copied or used the string
+    //       before the next call to getParameterStrValue
+    static const char * ratio_strings[NUM_RATIO_VALUES] = {
+      "1.5:1",
+      "2:1",
+      "3:1",
+      "4:1",
+      "6:1",
+      "8:1",
+      "12:1",
+      "20:1",
+      "LIMIT",
+    };
+
     switch (index) {
-      // Note: String memory must be accessible even after function returned.
-      //       It can be assumed that caller will have copied or used the string
-      //       before the next call to getParameterStrValue
+      case RATIO:
+        if (value >= RATIO_1_5 && value < NUM_RATIO_VALUES)
+          return ratio_strings[value];
+        break;
       default:
         break;
     }
@@ -147,10 +270,37 @@ class MasterFX {
 
   std::atomic_uint_fast32_t flags_;
 
+  Params params_;
+
+  dsp::Compressor comp_;
+
   /*===========================================================================*/
   /* Private Methods. */
   /*===========================================================================*/
 
+  static inline int32_t clip(int32_t value, int32_t min, int32_t max) {
+    return (value < min) ? min : (value > max) ? max : value;
+  }
+
+  inline void updateCompressor(uint32_t flags) {
+    static const float ratios[NUM_RATIO_VALUES] = {
+      1.5f, 2.f, 3.f, 4.f, 6.f, 8.f, 12.f, 20.f, 0.f
+    };
+
+    if (flags & k_flag_thresh)
+      comp_.setThreshold(0.1f * params_.thresh);
+    if (flags & k_flag_ratio)
+      comp_.setRatio(ratios[params_.ratio]);
+    if (flags & k_flag_knee)
+      comp_.setKnee(0.1f * params_.knee);
+    if (flags & k_flag_makeup)
+      comp_.setMakeup(0.1f * params_.makeup);
+    if (flags & k_flag_attack)
+      comp_.setLookahead(0.0001f * params_.attack);
+    if (flags & k_flag_release)
+      comp_.setRelease(0.001f * params_.release);
+  }
+
   /*===========================================================================*/
   /* Constants. */
   /*===========================================================================*/
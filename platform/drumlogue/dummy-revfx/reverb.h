@@ -13,22 +13,72 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cmath>
 
 #include <arm_neon.h>
 
 #include "unit.h"  // Note: Include common definitions for all units
 
+#include "dsp/convolver.hpp"
+
 class Reverb {
  public:
   /*===========================================================================*/
   /* Public Data Structures/Types. */
   /*===========================================================================*/
 
+  enum {
+    BANK = 0U,
+    SAMPLE,
+    LENGTH,
+    MIX,
+    NUM_PARAMS
+  };
+
+  enum {
+    BANK_SYNTH = 0,  // built-in synthetic impulse, others select sample bank (value - 1)
+    NUM_BANK_VALUES = 8,
+  };
+
+  // Note: raw parameter values, as described in header.c
+  struct Params {
+    int32_t bank{BANK_SYNTH};
+    int32_t sample{1};
+    int32_t length{250};
+    int32_t mix{0};
+
+    void reset() {
+      bank = BANK_SYNTH;
+      sample = 1;
+      length = 250;
+      mix = 0;
+    }
+  };
+
+  enum {
+    k_flags_none  = 0,
+    k_flag_length = 1<<0,
+    k_flag_mix    = 1<<1,
+    k_flags_all   = k_flag_length | k_flag_mix,
+  };
+
+  // Note: partitions match the 64 frame render buffer, so each buffer runs a single partition.
+  //       Other buffer sizes are handled by the convolver's input buffering.
+  //       Every partition streams its spectrum and delay line slot once per buffer, ~1KB per
+  //       channel, so the impulse length is capped to keep that traffic within the render budget.
+  enum {
+    k_partition_exp = 6,
+    k_max_partitions = 188,  // 250ms impulse at 48kHz
+    k_max_chunk_frames = 64,
+  };
+
+  typedef dsp::PartitionedConvolver<k_partition_exp, k_max_partitions> Convolver;
+
   /*===========================================================================*/
   /* Lifecycle Methods. */
   /*===========================================================================*/
 
-  Reverb(void) {}
+  Reverb(void) : flags_(k_flags_none), pending_(-1) {}
   virtual ~Reverb(void) {}
 
   inline int8_t Init(const unit_runtime_desc_t * desc) {
@@ -40,7 +90,22 @@ class Reverb {
     if (desc->input_channels != 2 || desc->output_channels != 2)  // should be stereo input/output
       return k_unit_err_geometry;
 
-    // Note: if need to allocate some memory can do it here and return k_unit_err_memory if getting allocation errors
+    // Note: sample access callbacks are kept to load impulse responses on parameter changes
+    get_num_sample_banks_ = desc->get_num_sample_banks;
+    get_num_samples_for_bank_ = desc->get_num_samples_for_bank;
+    get_sample_ = desc->get_sample;
+
+    generateSynthImpulse();
+
+    params_.reset();
+    published_ = 1;
+    pending_ = -1;
+    loadImpulse();
+    updateParams(k_flags_all);
+    flags_ = k_flags_none;
+
+    conv_l_.reset();
+    conv_r_.reset();
 
     return k_unit_err_none;
   }
@@ -51,6 +116,8 @@ class Reverb {
 
   inline void Reset() {
     // Note: Reset effect state.
+    conv_l_.reset();
+    conv_r_.reset();
   }
 
   inline void Resume() {
@@ -68,20 +135,66 @@ class Reverb {
   /*===========================================================================*/
 
   fast_inline void Process(const float * in, float * out, size_t frames) {
+    // Note: pick up impulse spectra published by loadImpulse()
+    const int32_t slot = pending_.exchange(-1, std::memory_order_acquire);
+    if (slot >= 0) {
+      conv_l_.setSpectra(&spectra_[slot][0]);
+      conv_r_.setSpectra(&spectra_[slot][1]);
+    }
+
+    const uint32_t flags = flags_.exchange(k_flags_none, std::memory_order_relaxed);
+    if (flags)
+      updateParams(flags);
+
+    float wet[k_max_chunk_frames << 1] __attribute__((aligned(16)));
+
     const float * __restrict in_p = in;
     float * __restrict out_p = out;
-    const float * out_e = out_p + (frames << 1);  // assuming stereo output
 
-    for (; out_p != out_e; in_p += 2, out_p += 2) {
-      // Note: should take advantage of NEON ArmV7 instructions
-      float32x2_t sig = vld1_f32(in_p);
-      vst1_f32(out_p, vmul_n_f32(sig, 0.f));
+    while (frames) {
+      const size_t n = (frames < k_max_chunk_frames) ? frames : (size_t)k_max_chunk_frames;
+
+      conv_l_.process(in_p, wet, n, 2);
+      conv_r_.process(in_p + 1, wet + 1, n, 2);
+
+      const float * wet_p = wet;
+      const float * out_e = out_p + (n << 1);  // assuming stereo output
+      for (; out_p != out_e; in_p += 2, wet_p += 2, out_p += 2) {
+        const float32x2_t dry = vmul_n_f32(vld1_f32(in_p), dry_gain_);
+        vst1_f32(out_p, vmla_n_f32(dry, vld1_f32(wet_p), wet_gain_));
+      }
+
+      frames -= n;
     }
   }
 
   inline void setParameter(uint8_t index, int32_t value) {
-    (void)value;
     switch (index) {
+      case BANK:
+        value = clip(value, BANK_SYNTH, NUM_BANK_VALUES - 1);
+        if (value != params_.bank) {
+          params_.bank = value;
+          loadImpulse();
+        }
+        break;
+      case SAMPLE:
+        value = clip(value, 1, 128);
+        if (value != params_.sample) {
+          params_.sample = value;
+          if (params_.bank != BANK_SYNTH)
+            loadImpulse();
+        }
+        break;
+      case LENGTH:
+        // 50 .. 250 ms
+        params_.length = clip(value, 50, 250);
+        flags_.fetch_or(k_flag_length);
+        break;
+      case MIX:
+        // -100.0 .. 100.0, 1 decimal
+        params_.mix = clip(value, -1000, 1000);
+        flags_.fetch_or(k_flag_mix);
+        break;
       default:
         break;
     }
@@ -89,6 +202,14 @@ class Reverb {
 
   inline int32_t getParameterValue(uint8_t index) const {
     switch (index) {
+      case BANK:
+        return params_.bank;
+      case SAMPLE:
+        return params_.sample;
+      case LENGTH:
+        return params_.length;
+      case MIX:
+        return params_.mix;
       default:
         break;
     }
@@ -96,11 +217,31 @@ class Reverb {
   }
 
   inline const char * getParameterStrValue(uint8_t index, int32_t value) const {
-    (void)value;
+    // Note: String memory must be accessible even after function returned.
+    //       It can be assumed that caller will have copied or used the string
+    //       before the next call to getParameterStrValue
+    static const char * bank_strings[NUM_BANK_VALUES] = {
+      "SYNTH",
+      "BANK 1",
+      "BANK 2",
+      "BANK 3",
+      "BANK 4",
+      "BANK 5",
+      "BANK 6",
+      "BANK 7",
+    };
+
     switch (index) {
-      // Note: String memory must be accessible even after function returned.
-      //       It can be assumed that caller will have copied or used the string
-      //       before the next call to getParameterStrValue
+      case BANK:
+        if (value >= BANK_SYNTH && value < NUM_BANK_VALUES)
+          return bank_strings[value];
+        break;
+      case SAMPLE:
+        {
+          // Note: sample names are owned by the runtime and outlive this call
+          const sample_wrapper_t * s = getSample(params_.bank, value);
+          return s ? s->name : "---";
+        }
       default:
         break;
     }
@@ -144,13 +285,112 @@ class Reverb {
 
   std::atomic_uint_fast32_t flags_;
 
-  float reverb_line_[24000U << 1] __attribute__((aligned(16)));
+  Params params_;
+
+  unit_runtime_get_num_sample_banks_ptr get_num_sample_banks_{nullptr};
+  unit_runtime_get_num_samples_for_bank_ptr get_num_samples_for_bank_{nullptr};
+  unit_runtime_get_sample_ptr get_sample_{nullptr};
+
+  float dry_gain_{0.5f};
+  float wet_gain_{0.5f};
+
+  Convolver conv_l_;
+  Convolver conv_r_;
+
+  // Note: double buffered impulse spectra, [slot][channel]. A slot is filled by loadImpulse()
+  //       while the other one may be in use by Process(), and handed over via pending_.
+  Convolver::Spectra spectra_[2][2];
+  std::atomic_int_fast32_t pending_;
+  int32_t published_{1};
+
+  float synth_ir_[Convolver::k_max_frames << 1] __attribute__((aligned(16)));
 
   /*===========================================================================*/
   /* Private Methods. */
   /*===========================================================================*/
 
+  static inline int32_t clip(int32_t value, int32_t min, int32_t max) {
+    return (value < min) ? min : (value > max) ? max : value;
+  }
+
+  inline const sample_wrapper_t * getSample(int32_t bank, int32_t sample) const {
+    if (bank == BANK_SYNTH || !get_sample_ || !get_num_sample_banks_ || !get_num_samples_for_bank_)
+      return nullptr;
+    const uint8_t b = bank - 1;
+    if (b >= get_num_sample_banks_() || sample < 1 || sample > get_num_samples_for_bank_(b))
+      return nullptr;
+    const sample_wrapper_t * s = get_sample_(b, sample - 1);
+    if (!s || !s->sample_ptr || !s->frames || !s->channels)
+      return nullptr;
+    return s;
+  }
+
+  inline void updateParams(uint32_t flags) {
+    if (flags & k_flag_length) {
+      const uint32_t parts = (params_.length * 48 + Convolver::k_partition_size - 1) >> k_partition_exp;
+      conv_l_.setPartitions(parts);
+      conv_r_.setPartitions(parts);
+    }
+    if (flags & k_flag_mix) {
+      const float wet = 0.5f * (0.001f * params_.mix + 1.f);
+      wet_gain_ = wet;
+      dry_gain_ = 1.f - wet;
+    }
+  }
+
+  // Note: called from Init() and setParameter(), i.e. outside of the render callback
+  inline void loadImpulse() {
+    // Cancel a hand over not yet picked up by Process(), in which case its slot is still unused.
+    // Otherwise Process() uses the last published slot, and the other one is free.
+    const int32_t cancelled = pending_.exchange(-1, std::memory_order_acq_rel);
+    const int32_t slot = (cancelled >= 0) ? cancelled : 1 - published_;
+
+    const float * ir = synth_ir_;
+    size_t frames = Convolver::k_max_frames;
+    size_t channels = 2;
+
+    const sample_wrapper_t * s = getSample(params_.bank, params_.sample);
+    if (s) {
+      ir = s->sample_ptr;
+      frames = (s->frames < Convolver::k_max_frames) ? s->frames : (size_t)Convolver::k_max_frames;
+      channels = s->channels;
+    }
+
+    // Normalize to unit energy averaged over channels, so that wet level does not depend on impulse
+    float energy = 0.f;
+    for (size_t i = 0; i < frames * channels; ++i)
+      energy += ir[i] * ir[i];
+    energy /= channels;
+    const float gain = (energy > 1e-9f) ? k_ir_level / sqrtf(energy) : 0.f;
+
+    // Note: mono impulses are used for both channels, only the first two channels are used otherwise
+    conv_l_.prepare(spectra_[slot][0], ir, frames, channels, gain);
+    conv_r_.prepare(spectra_[slot][1], ir + ((channels > 1) ? 1 : 0), frames, channels, gain);
+
+    published_ = slot;
+    pending_.store(slot, std::memory_order_release);
+  }
+
+  // Decorrelated exponentially decaying noise per channel, with a short onset ramp
+  inline void generateSynthImpulse() {
+    const float decay = -6.9077553f / (k_synth_rt60 * 48000.f);  // -60dB at k_synth_rt60
+    const float onset = 1.f / (k_synth_onset * 48000.f);
+    uint32_t seed_l = 0x12345678U;
+    uint32_t seed_r = 0x87654321U;
+    for (uint32_t i = 0; i < Convolver::k_max_frames; ++i) {
+      seed_l = seed_l * 1664525U + 1013904223U;
+      seed_r = seed_r * 1664525U + 1013904223U;
+      const float ramp = (i * onset < 1.f) ? i * onset : 1.f;
+      const float env = ramp * expf(decay * i);
+      synth_ir_[2 * i] = env * ((int32_t)seed_l * 4.656612873e-10f);
+      synth_ir_[2 * i + 1] = env * ((int32_t)seed_r * 4.656612873e-10f);
+    }
+  }
   /*===========================================================================*/
   /* Constants. */
   /*===========================================================================*/
+
+  static constexpr float k_ir_level = 0.5f;
+  static constexpr float k_synth_rt60 = 0.25f;
+  static constexpr float k_synth_onset = 0.005f;
 };
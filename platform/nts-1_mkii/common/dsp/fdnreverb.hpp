@@ -0,0 +1,339 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    fdnreverb.hpp
+ * @brief   Feedback delay network reverb.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "utils/float_math.h"
+#include "utils/int_math.h"
+#include "utils/buffer_ops.h"
+#include "dsp/delayline.hpp"
+#include "dsp/simplelfo.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Eight line feedback delay network reverb.
+   *
+   * Lines are carved out of a single memory arena, mixed through an orthogonal
+   * matrix evaluated with add/sub butterflies, damped with one-pole lowpass
+   * filters and read at LFO-modulated fractional positions.
+   */
+  struct FDNReverb {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_num_lines = 8,
+      k_max_mod_depth = 32, // Maximum modulation depth in samples
+    };
+
+    /**
+     * Feedback matrix types
+     */
+    enum {
+      k_matrix_hadamard = 0U,
+      k_matrix_householder,
+      k_num_matrix_types
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    FDNReverb(void) :
+      mSize(1.f),
+      mMaxSize(1.f),
+      mDecay(1.f),
+      mDamp(0.f),
+      mModDepth(0.f),
+      mFsRecip(1.f / 48000.f),
+      mMatrix(k_matrix_hadamard)
+    {
+      for (int i = 0; i < k_num_lines; ++i) {
+        mDelay[i] = baseDelay(i);
+        mGain[i] = 0.f;
+        mDampZ[i] = 0.f;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set the memory arena backing all delay lines.
+     *
+     * @param ram Pointer to memory arena, must hold k_num_lines * line_size floats
+     * @param line_size Size in float of each delay line, must be a power of two
+     */
+    inline __attribute__((optimize("Ofast")))
+    void setMemory(float *ram, size_t line_size) {
+      for (int i = 0; i < k_num_lines; ++i)
+        mLines[i].setMemory(ram + i * line_size, line_size);
+
+      // Leave headroom for modulation and interpolation taps
+      mMaxSize = (line_size - k_max_mod_depth - 4) / (float)baseDelay(k_num_lines-1);
+      setSize(mSize);
+    }
+
+    /**
+     * Zero clear delay lines and filter states.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void clear(void) {
+      for (int i = 0; i < k_num_lines; ++i) {
+        mLines[i].clear();
+        mDampZ[i] = 0.f;
+      }
+    }
+
+    /**
+     * Set sampling frequency reciprocal, used for decay and modulation rate calculations.
+     *
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast")))
+    void setSamplingRate(const float fsrecip) {
+      mFsRecip = fsrecip;
+      updateGains();
+    }
+
+    /**
+     * Set room size, as a scaling factor applied to base line lengths.
+     *
+     * @param size Scaling factor, clipped to what the arena can hold
+     */
+    inline __attribute__((optimize("Ofast")))
+    void setSize(const float size) {
+      mSize = clipminmaxf(0.1f, size, mMaxSize);
+      for (int i = 0; i < k_num_lines; ++i)
+        mDelay[i] = mSize * baseDelay(i);
+      updateGains();
+    }
+
+    /**
+     * Set decay time.
+     *
+     * @param rt60 Time in seconds for the tail to decay by 60dB
+     */
+    inline __attribute__((optimize("Ofast")))
+    void setDecay(const float rt60) {
+      mDecay = clipminf(0.01f, rt60);
+      updateGains();
+    }
+
+    /**
+     * Set high frequency damping.
+     *
+     * @param damp Damping amount in [0, 1), 0 is no damping
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDamping(const float damp) {
+      mDamp = clipminmaxf(0.f, damp, 0.99f);
+    }
+
+    /**
+     * Set delay line modulation.
+     *
+     * @param depth Modulation depth in [0, 1], scaled to the maximum modulation depth in samples
+     * @param rate Modulation rate in Hz
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setModulation(const float depth, const float rate) {
+      mModDepth = clip01f(depth) * k_max_mod_depth;
+      mLfo.setF0(rate, mFsRecip);
+    }
+
+    /**
+     * Select feedback matrix type.
+     *
+     * @param type One of k_matrix_hadamard, k_matrix_householder
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMatrix(const uint32_t type) {
+      mMatrix = (type < k_num_matrix_types) ? type : (uint32_t)k_matrix_hadamard;
+    }
+
+    /**
+     * Process a block of interleaved stereo samples.
+     *
+     * @param in Interleaved stereo input
+     * @param out Interleaved stereo output, wet signal only
+     * @param frames Number of frames to process
+     *
+     * @note Input and output may point to the same buffer.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(const float * in, float * out, const size_t frames) {
+      const float damp = mDamp;
+      const float depth = mModDepth;
+      const bool householder = (mMatrix == k_matrix_householder);
+
+      float x[k_num_lines];
+
+      const float * out_e = out + 2 * frames;
+      for (; out != out_e; in += 2, out += 2) {
+        const float inl = 0.5f * in[0];
+        const float inr = 0.5f * in[1];
+
+        // Read modulated line outputs, with quadrature spread LFO phases
+        const float m0 = depth * mLfo.sine_uni();
+        const float m1 = depth * mLfo.sine_uni_off(0.25f);
+        mLfo.cycle();
+
+        for (int i = 0; i < k_num_lines; ++i) {
+          const float mod = (i & 1) ? m1 : m0;
+          const float s = mLines[i].readFracHermite(mDelay[i] + ((i & 2) ? depth - mod : mod));
+          mDampZ[i] = linintf(damp, s, mDampZ[i]);
+          x[i] = mGain[i] * mDampZ[i];
+        }
+
+        // Line outputs are tapped before mixing, alternating signs for decorrelation
+        out[0] = 0.5f * (x[0] - x[2] + x[4] - x[6]);
+        out[1] = 0.5f * (x[1] - x[3] + x[5] - x[7]);
+
+        if (householder)
+          householder8(x);
+        else
+          hadamard8(x);
+
+        // Feed back with left input on even lines and right input on odd lines
+        for (int i = 0; i < k_num_lines; i += 2) {
+          mLines[i].write(x[i] + inl);
+          mLines[i+1].write(x[i+1] + inr);
+        }
+      }
+    }
+
+    /**
+     * Recalculate per line feedback gains for current sizes and decay time.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void updateGains(void) {
+      // g = 10^(-3 * d / (rt60 * fs)), in base 2
+      const float k = -3.f * 3.321928094887362f * mFsRecip / mDecay;
+      for (int i = 0; i < k_num_lines; ++i)
+        mGain[i] = fastpow2f(clipminf(-126.f, k * mDelay[i]));
+    }
+
+    /*===========================================================================*/
+    /* Static Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Get base length of a line in samples, at unit size. Lengths are mutually prime.
+     *
+     * @param i Line index
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    uint32_t baseDelay(const int i) {
+      static const uint32_t delays[k_num_lines] = {
+        1031, 1327, 1523, 1693, 1931, 2179, 2357, 2591
+      };
+      return delays[i];
+    }
+
+    /**
+     * In place 8 point orthonormal Hadamard transform, using 3 stages of butterflies.
+     *
+     * @param x Vector to transform
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    void hadamard8(float * __restrict x) {
+      for (int h = 1; h < k_num_lines; h <<= 1) {
+        for (int i = 0; i < k_num_lines; i += (h << 1)) {
+          for (int j = i; j < i + h; ++j) {
+            const float a = x[j];
+            const float b = x[j+h];
+            x[j] = a + b;
+            x[j+h] = a - b;
+          }
+        }
+      }
+      for (int i = 0; i < k_num_lines; ++i)
+        x[i] *= 0.35355339059327373f; // 1/sqrt(8)
+    }
+
+    /**
+     * In place 8 point Householder reflection, I - 2/N * 1 * 1^T.
+     *
+     * @param x Vector to transform
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    void householder8(float * __restrict x) {
+      float sum = 0.f;
+      for (int i = 0; i < k_num_lines; ++i)
+        sum += x[i];
+      sum *= 2.f / k_num_lines;
+      for (int i = 0; i < k_num_lines; ++i)
+        x[i] -= sum;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DelayLine mLines[k_num_lines];
+    float     mDelay[k_num_lines];
+    float     mGain[k_num_lines];
+    float     mDampZ[k_num_lines];
+    SimpleLFO mLfo;
+    float     mSize;
+    float     mMaxSize;
+    float     mDecay;
+    float     mDamp;
+    float     mModDepth;
+    float     mFsRecip;
+    uint32_t  mMatrix;
+
+  };
+
+}
+
+/** @} */
@@ -0,0 +1,515 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    fft.hpp
+ * @brief   Real FFT for power of two sizes from 64 to 4096.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Twiddle factor table shared by all FFT sizes.
+   *
+   * A quarter sine wave at 4096 points per cycle, kept const so that it stays in flash.
+   */
+  struct FFTTables {
+
+    enum {
+      k_resolution = 4096,  /**< Table points per full cycle. */
+      k_quarter = 1024,     /**< Table points per quarter cycle. */
+    };
+
+    /**
+     * Get quarter sine table, sin(pi/2 * i / 1024) for i in [0, 1024].
+     */
+    static inline __attribute__((always_inline))
+    const float * quarterSine(void) {
+      static const float t[k_quarter + 1] = {
+        0.0000000000e+00f, 1.5339801863e-03f, 3.0679567630e-03f, 4.6019261204e-03f, 6.1358846492e-03f, 7.6698287395e-03f,
+        9.2037547821e-03f, 1.0737659167e-02f, 1.2271538286e-02f, 1.3805388528e-02f, 1.5339206285e-02f, 1.6872987947e-02f,
+        1.8406729906e-02f, 1.9940428552e-02f, 2.1474080275e-02f, 2.3007681469e-02f, 2.4541228523e-02f, 2.6074717829e-02f,
+        2.7608145779e-02f, 2.9141508764e-02f, 3.0674803177e-02f, 3.2208025408e-02f, 3.3741171851e-02f, 3.5274238898e-02f,
+        3.6807222941e-02f, 3.8340120374e-02f, 3.9872927588e-02f, 4.1405640977e-02f, 4.2938256935e-02f, 4.4470771855e-02f,
+        4.6003182131e-02f, 4.7535484157e-02f, 4.9067674327e-02f, 5.0599749037e-02f, 5.2131704680e-02f, 5.3663537653e-02f,
+        5.5195244350e-02f, 5.6726821167e-02f, 5.8258264500e-02f, 5.9789570747e-02f, 6.1320736302e-02f, 6.2851757564e-02f,
+        6.4382630930e-02f, 6.5913352797e-02f, 6.7443919564e-02f, 6.8974327628e-02f, 7.0504573390e-02f, 7.2034653247e-02f,
+        7.3564563600e-02f, 7.5094300848e-02f, 7.6623861392e-02f, 7.8153241633e-02f, 7.9682437971e-02f, 8.1211446810e-02f,
+        8.2740264549e-02f, 8.4268887593e-02f, 8.5797312344e-02f, 8.7325535206e-02f, 8.8853552583e-02f, 9.0381360878e-02f,
+        9.1908956497e-02f, 9.3436335846e-02f, 9.4963495330e-02f, 9.6490431355e-02f, 9.8017140330e-02f, 9.9543618660e-02f,
+        1.0106986275e-01f, 1.0259586902e-01f, 1.0412163387e-01f, 1.0564715371e-01f, 1.0717242496e-01f, 1.0869744401e-01f,
+        1.1022220729e-01f, 1.1174671121e-01f, 1.1327095218e-01f, 1.1479492661e-01f, 1.1631863091e-01f, 1.1784206151e-01f,
+        1.1936521481e-01f, 1.2088808724e-01f, 1.2241067520e-01f, 1.2393297512e-01f, 1.2545498341e-01f, 1.2697669650e-01f,
+        1.2849811079e-01f, 1.3001922272e-01f, 1.3154002870e-01f, 1.3306052516e-01f, 1.3458070851e-01f, 1.3610057518e-01f,
+        1.3762012159e-01f, 1.3913934416e-01f, 1.4065823933e-01f, 1.4217680352e-01f, 1.4369503315e-01f, 1.4521292465e-01f,
+        1.4673047446e-01f, 1.4824767899e-01f, 1.4976453468e-01f, 1.5128103796e-01f, 1.5279718526e-01f, 1.5431297301e-01f,
+        1.5582839765e-01f, 1.5734345562e-01f, 1.5885814333e-01f, 1.6037245724e-01f, 1.6188639378e-01f, 1.6339994938e-01f,
+        1.6491312049e-01f, 1.6642590354e-01f, 1.6793829497e-01f, 1.6945029123e-01f, 1.7096188876e-01f, 1.7247308400e-01f,
+        1.7398387339e-01f, 1.7549425338e-01f, 1.7700422041e-01f, 1.7851377094e-01f, 1.8002290141e-01f, 1.8153160826e-01f,
+        1.8303988796e-01f, 1.8454773694e-01f, 1.8605515166e-01f, 1.8756212858e-01f, 1.8906866415e-01f, 1.9057475482e-01f,
+        1.9208039705e-01f, 1.9358558730e-01f, 1.9509032202e-01f, 1.9659459767e-01f, 1.9809841072e-01f, 1.9960175762e-01f,
+        2.0110463484e-01f, 2.0260703884e-01f, 2.0410896609e-01f, 2.0561041305e-01f, 2.0711137619e-01f, 2.0861185198e-01f,
+        2.1011183688e-01f, 2.1161132737e-01f, 2.1311031992e-01f, 2.1460881099e-01f, 2.1610679708e-01f, 2.1760427464e-01f,
+        2.1910124016e-01f, 2.2059769011e-01f, 2.2209362097e-01f, 2.2358902923e-01f, 2.2508391136e-01f, 2.2657826385e-01f,
+        2.2807208317e-01f, 2.2956536582e-01f, 2.3105810828e-01f, 2.3255030704e-01f, 2.3404195858e-01f, 2.3553305940e-01f,
+        2.3702360599e-01f, 2.3851359484e-01f, 2.4000302245e-01f, 2.4149188530e-01f, 2.4298017990e-01f, 2.4446790275e-01f,
+        2.4595505034e-01f, 2.4744161917e-01f, 2.4892760575e-01f, 2.5041300657e-01f, 2.5189781815e-01f, 2.5338203700e-01f,
+        2.5486565960e-01f, 2.5634868249e-01f, 2.5783110216e-01f, 2.5931291513e-01f, 2.6079411792e-01f, 2.6227470702e-01f,
+        2.6375467897e-01f, 2.6523403029e-01f, 2.6671275747e-01f, 2.6819085706e-01f, 2.6966832557e-01f, 2.7114515953e-01f,
+        2.7262135545e-01f, 2.7409690987e-01f, 2.7557181931e-01f, 2.7704608031e-01f, 2.7851968939e-01f, 2.7999264308e-01f,
+        2.8146493793e-01f, 2.8293657046e-01f, 2.8440753721e-01f, 2.8587783473e-01f, 2.8734745954e-01f, 2.8881640821e-01f,
+        2.9028467725e-01f, 2.9175226323e-01f, 2.9321916269e-01f, 2.9468537218e-01f, 2.9615088824e-01f, 2.9761570744e-01f,
+        2.9907982631e-01f, 3.0054324142e-01f, 3.0200594932e-01f, 3.0346794657e-01f, 3.0492922974e-01f, 3.0638979537e-01f,
+        3.0784964004e-01f, 3.0930876031e-01f, 3.1076715275e-01f, 3.1222481392e-01f, 3.1368174040e-01f, 3.1513792875e-01f,
+        3.1659337556e-01f, 3.1804807739e-01f, 3.1950203082e-01f, 3.2095523243e-01f, 3.2240767880e-01f, 3.2385936652e-01f,
+        3.2531029216e-01f, 3.2676045232e-01f, 3.2820984358e-01f, 3.2965846253e-01f, 3.3110630576e-01f, 3.3255336987e-01f,
+        3.3399965144e-01f, 3.3544514708e-01f, 3.3688985339e-01f, 3.3833376697e-01f, 3.3977688441e-01f, 3.4121920232e-01f,
+        3.4266071731e-01f, 3.4410142599e-01f, 3.4554132496e-01f, 3.4698041085e-01f, 3.4841868025e-01f, 3.4985612979e-01f,
+        3.5129275609e-01f, 3.5272855576e-01f, 3.5416352542e-01f, 3.5559766170e-01f, 3.5703096123e-01f, 3.5846342063e-01f,
+        3.5989503653e-01f, 3.6132580557e-01f, 3.6275572437e-01f, 3.6418478957e-01f, 3.6561299780e-01f, 3.6704034572e-01f,
+        3.6846682995e-01f, 3.6989244715e-01f, 3.7131719395e-01f, 3.7274106701e-01f, 3.7416406297e-01f, 3.7558617849e-01f,
+        3.7700741022e-01f, 3.7842775481e-01f, 3.7984720892e-01f, 3.8126576922e-01f, 3.8268343237e-01f, 3.8410019502e-01f,
+        3.8551605384e-01f, 3.8693100551e-01f, 3.8834504670e-01f, 3.8975817407e-01f, 3.9117038430e-01f, 3.9258167407e-01f,
+        3.9399204006e-01f, 3.9540147895e-01f, 3.9680998742e-01f, 3.9821756215e-01f, 3.9962419985e-01f, 4.0102989718e-01f,
+        4.0243465086e-01f, 4.0383845757e-01f, 4.0524131400e-01f, 4.0664321687e-01f, 4.0804416286e-01f, 4.0944414869e-01f,
+        4.1084317106e-01f, 4.1224122667e-01f, 4.1363831224e-01f, 4.1503442448e-01f, 4.1642956010e-01f, 4.1782371582e-01f,
+        4.1921688836e-01f, 4.2060907445e-01f, 4.2200027080e-01f, 4.2339047414e-01f, 4.2477968121e-01f, 4.2616788873e-01f,
+        4.2755509343e-01f, 4.2894129206e-01f, 4.3032648134e-01f, 4.3171065803e-01f, 4.3309381885e-01f, 4.3447596057e-01f,
+        4.3585707992e-01f, 4.3723717366e-01f, 4.3861623854e-01f, 4.3999427131e-01f, 4.4137126873e-01f, 4.4274722756e-01f,
+        4.4412214457e-01f, 4.4549601651e-01f, 4.4686884016e-01f, 4.4824061229e-01f, 4.4961132965e-01f, 4.5098098905e-01f,
+        4.5234958723e-01f, 4.5371712100e-01f, 4.5508358713e-01f, 4.5644898240e-01f, 4.5781330360e-01f, 4.5917654752e-01f,
+        4.6053871096e-01f, 4.6189979070e-01f, 4.6325978355e-01f, 4.6461868631e-01f, 4.6597649577e-01f, 4.6733320874e-01f,
+        4.6868882204e-01f, 4.7004333246e-01f, 4.7139673683e-01f, 4.7274903195e-01f, 4.7410021465e-01f, 4.7545028175e-01f,
+        4.7679923006e-01f, 4.7814705642e-01f, 4.7949375766e-01f, 4.8083933060e-01f, 4.8218377208e-01f, 4.8352707893e-01f,
+        4.8486924800e-01f, 4.8621027612e-01f, 4.8755016015e-01f, 4.8888889692e-01f, 4.9022648329e-01f, 4.9156291611e-01f,
+        4.9289819223e-01f, 4.9423230852e-01f, 4.9556526183e-01f, 4.9689704902e-01f, 4.9822766697e-01f, 4.9955711255e-01f,
+        5.0088538261e-01f, 5.0221247405e-01f, 5.0353838373e-01f, 5.0486310853e-01f, 5.0618664535e-01f, 5.0750899105e-01f,
+        5.0883014254e-01f, 5.1015009671e-01f, 5.1146885044e-01f, 5.1278640063e-01f, 5.1410274419e-01f, 5.1541787802e-01f,
+        5.1673179902e-01f, 5.1804450410e-01f, 5.1935599017e-01f, 5.2066625414e-01f, 5.2197529294e-01f, 5.2328310348e-01f,
+        5.2458968268e-01f, 5.2589502747e-01f, 5.2719913478e-01f, 5.2850200154e-01f, 5.2980362469e-01f, 5.3110400115e-01f,
+        5.3240312788e-01f, 5.3370100181e-01f, 5.3499761989e-01f, 5.3629297907e-01f, 5.3758707630e-01f, 5.3887990853e-01f,
+        5.4017147273e-01f, 5.4146176585e-01f, 5.4275078486e-01f, 5.4403852673e-01f, 5.4532498842e-01f, 5.4661016691e-01f,
+        5.4789405917e-01f, 5.4917666219e-01f, 5.5045797294e-01f, 5.5173798840e-01f, 5.5301670558e-01f, 5.5429412145e-01f,
+        5.5557023302e-01f, 5.5684503728e-01f, 5.5811853122e-01f, 5.5939071186e-01f, 5.6066157620e-01f, 5.6193112124e-01f,
+        5.6319934401e-01f, 5.6446624152e-01f, 5.6573181078e-01f, 5.6699604883e-01f, 5.6825895267e-01f, 5.6952051935e-01f,
+        5.7078074589e-01f, 5.7203962932e-01f, 5.7329716670e-01f, 5.7455335505e-01f, 5.7580819142e-01f, 5.7706167286e-01f,
+        5.7831379641e-01f, 5.7956455914e-01f, 5.8081395810e-01f, 5.8206199034e-01f, 5.8330865294e-01f, 5.8455394295e-01f,
+        5.8579785746e-01f, 5.8704039352e-01f, 5.8828154822e-01f, 5.8952131864e-01f, 5.9075970186e-01f, 5.9199669496e-01f,
+        5.9323229504e-01f, 5.9446649918e-01f, 5.9569930449e-01f, 5.9693070806e-01f, 5.9816070700e-01f, 5.9938929840e-01f,
+        6.0061647938e-01f, 6.0184224706e-01f, 6.0306659854e-01f, 6.0428953095e-01f, 6.0551104140e-01f, 6.0673112703e-01f,
+        6.0794978497e-01f, 6.0916701234e-01f, 6.1038280628e-01f, 6.1159716393e-01f, 6.1281008243e-01f, 6.1402155893e-01f,
+        6.1523159058e-01f, 6.1644017453e-01f, 6.1764730794e-01f, 6.1885298796e-01f, 6.2005721176e-01f, 6.2125997651e-01f,
+        6.2246127937e-01f, 6.2366111753e-01f, 6.2485948814e-01f, 6.2605638840e-01f, 6.2725181550e-01f, 6.2844576660e-01f,
+        6.2963823891e-01f, 6.3082922963e-01f, 6.3201873594e-01f, 6.3320675505e-01f, 6.3439328416e-01f, 6.3557832049e-01f,
+        6.3676186124e-01f, 6.3794390362e-01f, 6.3912444486e-01f, 6.4030348218e-01f, 6.4148101281e-01f, 6.4265703397e-01f,
+        6.4383154289e-01f, 6.4500453682e-01f, 6.4617601298e-01f, 6.4734596864e-01f, 6.4851440102e-01f, 6.4968130739e-01f,
+        6.5084668500e-01f, 6.5201053110e-01f, 6.5317284295e-01f, 6.5433361783e-01f, 6.5549285300e-01f, 6.5665054573e-01f,
+        6.5780669330e-01f, 6.5896129298e-01f, 6.6011434207e-01f, 6.6126583784e-01f, 6.6241577759e-01f, 6.6356415861e-01f,
+        6.6471097820e-01f, 6.6585623367e-01f, 6.6699992230e-01f, 6.6814204143e-01f, 6.6928258835e-01f, 6.7042156038e-01f,
+        6.7155895485e-01f, 6.7269476907e-01f, 6.7382900038e-01f, 6.7496164610e-01f, 6.7609270358e-01f, 6.7722217014e-01f,
+        6.7835004313e-01f, 6.7947631990e-01f, 6.8060099780e-01f, 6.8172407417e-01f, 6.8284554639e-01f, 6.8396541180e-01f,
+        6.8508366777e-01f, 6.8620031168e-01f, 6.8731534089e-01f, 6.8842875278e-01f, 6.8954054474e-01f, 6.9065071413e-01f,
+        6.9175925836e-01f, 6.9286617482e-01f, 6.9397146089e-01f, 6.9507511398e-01f, 6.9617713149e-01f, 6.9727751083e-01f,
+        6.9837624941e-01f, 6.9947334464e-01f, 7.0056879394e-01f, 7.0166259474e-01f, 7.0275474446e-01f, 7.0384524052e-01f,
+        7.0493408038e-01f, 7.0602126145e-01f, 7.0710678119e-01f, 7.0819063703e-01f, 7.0927282644e-01f, 7.1035334686e-01f,
+        7.1143219575e-01f, 7.1250937056e-01f, 7.1358486878e-01f, 7.1465868786e-01f, 7.1573082528e-01f, 7.1680127852e-01f,
+        7.1787004506e-01f, 7.1893712237e-01f, 7.2000250796e-01f, 7.2106619931e-01f, 7.2212819393e-01f, 7.2318848931e-01f,
+        7.2424708295e-01f, 7.2530397237e-01f, 7.2635915508e-01f, 7.2741262860e-01f, 7.2846439045e-01f, 7.2951443815e-01f,
+        7.3056276923e-01f, 7.3160938122e-01f, 7.3265427167e-01f, 7.3369743811e-01f, 7.3473887810e-01f, 7.3577858917e-01f,
+        7.3681656888e-01f, 7.3785281479e-01f, 7.3888732446e-01f, 7.3992009546e-01f, 7.4095112535e-01f, 7.4198041172e-01f,
+        7.4300795214e-01f, 7.4403374418e-01f, 7.4505778544e-01f, 7.4608007351e-01f, 7.4710060598e-01f, 7.4811938045e-01f,
+        7.4913639452e-01f, 7.5015164581e-01f, 7.5116513191e-01f, 7.5217685045e-01f, 7.5318679904e-01f, 7.5419497532e-01f,
+        7.5520137690e-01f, 7.5620600141e-01f, 7.5720884651e-01f, 7.5820990981e-01f, 7.5920918898e-01f, 7.6020668165e-01f,
+        7.6120238548e-01f, 7.6219629813e-01f, 7.6318841726e-01f, 7.6417874054e-01f, 7.6516726562e-01f, 7.6615399020e-01f,
+        7.6713891194e-01f, 7.6812202852e-01f, 7.6910333765e-01f, 7.7008283699e-01f, 7.7106052426e-01f, 7.7203639715e-01f,
+        7.7301045336e-01f, 7.7398269061e-01f, 7.7495310659e-01f, 7.7592169904e-01f, 7.7688846567e-01f, 7.7785340421e-01f,
+        7.7881651238e-01f, 7.7977778792e-01f, 7.8073722857e-01f, 7.8169483207e-01f, 7.8265059617e-01f, 7.8360451861e-01f,
+        7.8455659716e-01f, 7.8550682956e-01f, 7.8645521360e-01f, 7.8740174703e-01f, 7.8834642763e-01f, 7.8928925317e-01f,
+        7.9023022144e-01f, 7.9116933022e-01f, 7.9210657730e-01f, 7.9304196048e-01f, 7.9397547755e-01f, 7.9490712633e-01f,
+        7.9583690461e-01f, 7.9676481021e-01f, 7.9769084094e-01f, 7.9861499463e-01f, 7.9953726911e-01f, 8.0045766219e-01f,
+        8.0137617172e-01f, 8.0229279554e-01f, 8.0320753148e-01f, 8.0412037740e-01f, 8.0503133114e-01f, 8.0594039057e-01f,
+        8.0684755354e-01f, 8.0775281793e-01f, 8.0865618159e-01f, 8.0955764240e-01f, 8.1045719825e-01f, 8.1135484702e-01f,
+        8.1225058659e-01f, 8.1314441485e-01f, 8.1403632971e-01f, 8.1492632906e-01f, 8.1581441081e-01f, 8.1670057287e-01f,
+        8.1758481315e-01f, 8.1846712958e-01f, 8.1934752008e-01f, 8.2022598257e-01f, 8.2110251499e-01f, 8.2197711528e-01f,
+        8.2284978138e-01f, 8.2372051123e-01f, 8.2458930279e-01f, 8.2545615400e-01f, 8.2632106285e-01f, 8.2718402727e-01f,
+        8.2804504526e-01f, 8.2890411477e-01f, 8.2976123379e-01f, 8.3061640031e-01f, 8.3146961230e-01f, 8.3232086777e-01f,
+        8.3317016470e-01f, 8.3401750111e-01f, 8.3486287499e-01f, 8.3570628435e-01f, 8.3654772722e-01f, 8.3738720162e-01f,
+        8.3822470555e-01f, 8.3906023707e-01f, 8.3989379420e-01f, 8.4072537497e-01f, 8.4155497744e-01f, 8.4238259964e-01f,
+        8.4320823964e-01f, 8.4403189549e-01f, 8.4485356525e-01f, 8.4567324699e-01f, 8.4649093877e-01f, 8.4730663869e-01f,
+        8.4812034480e-01f, 8.4893205521e-01f, 8.4974176800e-01f, 8.5054948127e-01f, 8.5135519311e-01f, 8.5215890162e-01f,
+        8.5296060493e-01f, 8.5376030114e-01f, 8.5455798837e-01f, 8.5535366474e-01f, 8.5614732838e-01f, 8.5693897742e-01f,
+        8.5772861000e-01f, 8.5851622426e-01f, 8.5930181836e-01f, 8.6008539043e-01f, 8.6086693864e-01f, 8.6164646114e-01f,
+        8.6242395611e-01f, 8.6319942171e-01f, 8.6397285612e-01f, 8.6474425752e-01f, 8.6551362409e-01f, 8.6628095402e-01f,
+        8.6704624552e-01f, 8.6780949676e-01f, 8.6857070597e-01f, 8.6932987135e-01f, 8.7008699111e-01f, 8.7084206347e-01f,
+        8.7159508666e-01f, 8.7234605889e-01f, 8.7309497842e-01f, 8.7384184347e-01f, 8.7458665228e-01f, 8.7532940310e-01f,
+        8.7607009420e-01f, 8.7680872381e-01f, 8.7754529021e-01f, 8.7827979166e-01f, 8.7901222643e-01f, 8.7974259280e-01f,
+        8.8047088905e-01f, 8.8119711347e-01f, 8.8192126435e-01f, 8.8264333998e-01f, 8.8336333867e-01f, 8.8408125871e-01f,
+        8.8479709843e-01f, 8.8551085614e-01f, 8.8622253015e-01f, 8.8693211879e-01f, 8.8763962040e-01f, 8.8834503331e-01f,
+        8.8904835585e-01f, 8.8974958638e-01f, 8.9044872324e-01f, 8.9114576479e-01f, 8.9184070939e-01f, 8.9253355540e-01f,
+        8.9322430120e-01f, 8.9391294515e-01f, 8.9459948563e-01f, 8.9528392104e-01f, 8.9596624976e-01f, 8.9664647018e-01f,
+        8.9732458071e-01f, 8.9800057974e-01f, 8.9867446569e-01f, 8.9934623698e-01f, 9.0001589202e-01f, 9.0068342923e-01f,
+        9.0134884705e-01f, 9.0201214390e-01f, 9.0267331824e-01f, 9.0333236849e-01f, 9.0398929312e-01f, 9.0464409058e-01f,
+        9.0529675932e-01f, 9.0594729781e-01f, 9.0659570451e-01f, 9.0724197792e-01f, 9.0788611649e-01f, 9.0852811872e-01f,
+        9.0916798309e-01f, 9.0980570810e-01f, 9.1044129226e-01f, 9.1107473406e-01f, 9.1170603201e-01f, 9.1233518462e-01f,
+        9.1296219043e-01f, 9.1358704795e-01f, 9.1420975570e-01f, 9.1483031224e-01f, 9.1544871609e-01f, 9.1606496580e-01f,
+        9.1667905992e-01f, 9.1729099701e-01f, 9.1790077562e-01f, 9.1850839433e-01f, 9.1911385169e-01f, 9.1971714629e-01f,
+        9.2031827671e-01f, 9.2091724153e-01f, 9.2151403934e-01f, 9.2210866874e-01f, 9.2270112833e-01f, 9.2329141672e-01f,
+        9.2387953251e-01f, 9.2446547433e-01f, 9.2504924078e-01f, 9.2563083051e-01f, 9.2621024214e-01f, 9.2678747430e-01f,
+        9.2736252565e-01f, 9.2793539482e-01f, 9.2850608047e-01f, 9.2907458126e-01f, 9.2964089584e-01f, 9.3020502289e-01f,
+        9.3076696108e-01f, 9.3132670908e-01f, 9.3188426558e-01f, 9.3243962927e-01f, 9.3299279883e-01f, 9.3354377298e-01f,
+        9.3409255040e-01f, 9.3463912982e-01f, 9.3518350994e-01f, 9.3572568948e-01f, 9.3626566717e-01f, 9.3680344174e-01f,
+        9.3733901191e-01f, 9.3787237644e-01f, 9.3840353406e-01f, 9.3893248353e-01f, 9.3945922360e-01f, 9.3998375303e-01f,
+        9.4050607059e-01f, 9.4102617505e-01f, 9.4154406518e-01f, 9.4205973977e-01f, 9.4257319760e-01f, 9.4308443747e-01f,
+        9.4359345816e-01f, 9.4410025849e-01f, 9.4460483726e-01f, 9.4510719329e-01f, 9.4560732538e-01f, 9.4610523237e-01f,
+        9.4660091308e-01f, 9.4709436635e-01f, 9.4758559102e-01f, 9.4807458592e-01f, 9.4856134992e-01f, 9.4904588185e-01f,
+        9.4952818059e-01f, 9.5000824500e-01f, 9.5048607395e-01f, 9.5096166631e-01f, 9.5143502097e-01f, 9.5190613681e-01f,
+        9.5237501272e-01f, 9.5284164760e-01f, 9.5330604035e-01f, 9.5376818989e-01f, 9.5422809511e-01f, 9.5468575494e-01f,
+        9.5514116831e-01f, 9.5559433413e-01f, 9.5604525135e-01f, 9.5649391890e-01f, 9.5694033573e-01f, 9.5738450079e-01f,
+        9.5782641303e-01f, 9.5826607141e-01f, 9.5870347490e-01f, 9.5913862246e-01f, 9.5957151308e-01f, 9.6000214574e-01f,
+        9.6043051942e-01f, 9.6085663311e-01f, 9.6128048581e-01f, 9.6170207653e-01f, 9.6212140427e-01f, 9.6253846804e-01f,
+        9.6295326687e-01f, 9.6336579978e-01f, 9.6377606580e-01f, 9.6418406395e-01f, 9.6458979329e-01f, 9.6499325285e-01f,
+        9.6539444170e-01f, 9.6579335887e-01f, 9.6619000345e-01f, 9.6658437448e-01f, 9.6697647104e-01f, 9.6736629222e-01f,
+        9.6775383709e-01f, 9.6813910475e-01f, 9.6852209427e-01f, 9.6890280478e-01f, 9.6928123536e-01f, 9.6965738512e-01f,
+        9.7003125319e-01f, 9.7040283869e-01f, 9.7077214073e-01f, 9.7113915845e-01f, 9.7150389099e-01f, 9.7186633748e-01f,
+        9.7222649708e-01f, 9.7258436893e-01f, 9.7293995221e-01f, 9.7329324605e-01f, 9.7364424965e-01f, 9.7399296217e-01f,
+        9.7433938279e-01f, 9.7468351069e-01f, 9.7502534507e-01f, 9.7536488512e-01f, 9.7570213004e-01f, 9.7603707904e-01f,
+        9.7636973133e-01f, 9.7670008613e-01f, 9.7702814266e-01f, 9.7735390015e-01f, 9.7767735782e-01f, 9.7799851493e-01f,
+        9.7831737072e-01f, 9.7863392443e-01f, 9.7894817532e-01f, 9.7926012265e-01f, 9.7956976569e-01f, 9.7987710370e-01f,
+        9.8018213597e-01f, 9.8048486177e-01f, 9.8078528040e-01f, 9.8108339115e-01f, 9.8137919331e-01f, 9.8167268620e-01f,
+        9.8196386911e-01f, 9.8225274137e-01f, 9.8253930229e-01f, 9.8282355120e-01f, 9.8310548743e-01f, 9.8338511032e-01f,
+        9.8366241921e-01f, 9.8393741345e-01f, 9.8421009239e-01f, 9.8448045538e-01f, 9.8474850180e-01f, 9.8501423101e-01f,
+        9.8527764239e-01f, 9.8553873531e-01f, 9.8579750917e-01f, 9.8605396335e-01f, 9.8630809724e-01f, 9.8655991026e-01f,
+        9.8680940181e-01f, 9.8705657131e-01f, 9.8730141816e-01f, 9.8754394179e-01f, 9.8778414164e-01f, 9.8802201714e-01f,
+        9.8825756773e-01f, 9.8849079285e-01f, 9.8872169196e-01f, 9.8895026451e-01f, 9.8917650996e-01f, 9.8940042779e-01f,
+        9.8962201746e-01f, 9.8984127846e-01f, 9.9005821026e-01f, 9.9027281236e-01f, 9.9048508426e-01f, 9.9069502544e-01f,
+        9.9090263543e-01f, 9.9110791372e-01f, 9.9131085985e-01f, 9.9151147332e-01f, 9.9170975367e-01f, 9.9190570043e-01f,
+        9.9209931314e-01f, 9.9229059135e-01f, 9.9247953460e-01f, 9.9266614245e-01f, 9.9285041446e-01f, 9.9303235020e-01f,
+        9.9321194923e-01f, 9.9338921115e-01f, 9.9356413552e-01f, 9.9373672194e-01f, 9.9390697000e-01f, 9.9407487930e-01f,
+        9.9424044945e-01f, 9.9440368006e-01f, 9.9456457073e-01f, 9.9472312110e-01f, 9.9487933079e-01f, 9.9503319944e-01f,
+        9.9518472667e-01f, 9.9533391214e-01f, 9.9548075549e-01f, 9.9562525638e-01f, 9.9576741447e-01f, 9.9590722942e-01f,
+        9.9604470090e-01f, 9.9617982860e-01f, 9.9631261218e-01f, 9.9644305135e-01f, 9.9657114579e-01f, 9.9669689520e-01f,
+        9.9682029929e-01f, 9.9694135776e-01f, 9.9706007034e-01f, 9.9717643674e-01f, 9.9729045668e-01f, 9.9740212990e-01f,
+        9.9751145614e-01f, 9.9761843514e-01f, 9.9772306664e-01f, 9.9782535041e-01f, 9.9792528620e-01f, 9.9802287377e-01f,
+        9.9811811290e-01f, 9.9821100336e-01f, 9.9830154493e-01f, 9.9838973741e-01f, 9.9847558057e-01f, 9.9855907423e-01f,
+        9.9864021818e-01f, 9.9871901223e-01f, 9.9879545621e-01f, 9.9886954991e-01f, 9.9894129319e-01f, 9.9901068585e-01f,
+        9.9907772775e-01f, 9.9914241872e-01f, 9.9920475862e-01f, 9.9926474729e-01f, 9.9932238459e-01f, 9.9937767039e-01f,
+        9.9943060456e-01f, 9.9948118697e-01f, 9.9952941750e-01f, 9.9957529605e-01f, 9.9961882250e-01f, 9.9965999674e-01f,
+        9.9969881870e-01f, 9.9973528826e-01f, 9.9976940535e-01f, 9.9980116989e-01f, 9.9983058180e-01f, 9.9985764101e-01f,
+        9.9988234745e-01f, 9.9990470108e-01f, 9.9992470184e-01f, 9.9994234968e-01f, 9.9995764455e-01f, 9.9997058643e-01f,
+        9.9998117528e-01f, 9.9998941108e-01f, 9.9999529381e-01f, 9.9999882345e-01f, 1.0000000000e+00f
+      };
+      return t;
+    }
+
+    /**
+     * Get cosine and sine of 2*pi*idx/4096.
+     *
+     * @param idx Angle index, in [0, 4096)
+     * @param c Receives cosine
+     * @param s Receives sine
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    void cossin(const uint32_t idx, float &c, float &s) {
+      const float * t = quarterSine();
+      const uint32_t r = idx & (k_quarter - 1);
+      switch (idx >> 10) {
+      case 0:
+        c = t[k_quarter - r]; s = t[r];
+        break;
+      case 1:
+        c = -t[r]; s = t[k_quarter - r];
+        break;
+      case 2:
+        c = -t[k_quarter - r]; s = -t[r];
+        break;
+      default:
+        c = t[r]; s = -t[k_quarter - r];
+        break;
+      }
+    }
+  };
+
+  /**
+   * In-place real FFT.
+   *
+   * The N point real transform is computed as an N/2 point complex transform followed
+   * by a split step. The complex transform is a radix-2^2 decimation in time FFT, i.e.:
+   * radix-4 butterflies with a single radix-2 stage first when log2(N/2) is odd.
+   *
+   * Spectra are packed as CMSIS does for arm_rfft_fast_f32():
+   * [Re(X0), Re(XN/2), Re(X1), Im(X1), ..., Re(XN/2-1), Im(XN/2-1)].
+   *
+   * Besides forward() and inverse(), the individual passes are exposed so that callers
+   * can spread a transform over several audio blocks. forward() runs bitReverse(),
+   * stage() for each stage then forwardPost(), inverse() runs inversePre(), bitReverse(),
+   * stage() for each stage then inversePost().
+   *
+   * @tparam SizeExp log2 of transform size, in [6, 12]
+   */
+  template <uint32_t SizeExp>
+  struct RealFFT {
+
+    static_assert(SizeExp >= 6 && SizeExp <= 12, "FFT size must be 64 to 4096");
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_size = 1U << SizeExp,                 /**< Real transform size N. */
+      k_complex_size = 1U << (SizeExp - 1),   /**< Complex transform size N/2. */
+      k_num_stages = SizeExp / 2,             /**< Complex transform butterfly stages. */
+    };
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Forward transform.
+     *
+     * @param x N real samples, replaced by packed spectrum
+     */
+    inline __attribute__((optimize("Ofast")))
+    void forward(float * x) {
+      bitReverse(x);
+      for (uint32_t s = 0; s < k_num_stages; ++s)
+        stage(x, s);
+      forwardPost(x);
+    }
+
+    /**
+     * Inverse transform, scaled so that inverse(forward(x)) == x.
+     *
+     * @param x Packed spectrum, replaced by N real samples
+     */
+    inline __attribute__((optimize("Ofast")))
+    void inverse(float * x) {
+      inversePre(x);
+      bitReverse(x);
+      for (uint32_t s = 0; s < k_num_stages; ++s)
+        stage(x, s);
+      inversePost(x);
+    }
+
+    /**
+     * Bit reversal permutation of the N/2 complex points.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void bitReverse(float * z) {
+      for (uint32_t i = 0, j = 0; i < k_complex_size; ++i) {
+        if (i < j) {
+          const float re = z[2*i];
+          const float im = z[2*i+1];
+          z[2*i] = z[2*j];
+          z[2*i+1] = z[2*j+1];
+          z[2*j] = re;
+          z[2*j+1] = im;
+        }
+        uint32_t bit = k_complex_size >> 1;
+        for (; j & bit; bit >>= 1)
+          j ^= bit;
+        j |= bit;
+      }
+    }
+
+    /**
+     * Run one butterfly stage of the complex transform.
+     *
+     * @param z N/2 interleaved complex points
+     * @param s Stage index, in [0, k_num_stages)
+     */
+    inline __attribute__((optimize("Ofast")))
+    void stage(float * z, const uint32_t s) {
+      if (k_odd) {
+        if (s == 0) {
+          radix2(z);
+          return;
+        }
+        radix4(z, 2U << (2 * (s - 1)));
+      }
+      else
+        radix4(z, 1U << (2 * s));
+    }
+
+    /**
+     * Split N/2 point complex spectrum into packed N point real spectrum.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void forwardPost(float * z) {
+      const float z0r = z[0];
+      const float z0i = z[1];
+      z[0] = z0r + z0i;
+      z[1] = z0r - z0i;
+
+      for (uint32_t k = 1; k <= k_complex_size / 2; ++k) {
+        const uint32_t m = k_complex_size - k;
+        const float zkr = z[2*k], zki = z[2*k+1];
+        const float zmr = z[2*m], zmi = z[2*m+1];
+
+        // Spectra of even and odd samples
+        const float er = 0.5f * (zkr + zmr);
+        const float ei = 0.5f * (zki - zmi);
+        const float orr = 0.5f * (zki + zmi);
+        const float oi = -0.5f * (zkr - zmr);
+
+        float c, s;
+        FFTTables::cossin(k << k_twiddle_shift, c, s);
+        const float tr = orr * c + oi * s;
+        const float ti = oi * c - orr * s;
+
+        z[2*m] = er - tr;
+        z[2*m+1] = ti - ei;
+        z[2*k] = er + tr;
+        z[2*k+1] = ei + ti;
+      }
+    }
+
+    /**
+     * Merge packed N point real spectrum into conjugated N/2 point complex spectrum,
+     * including inverse transform scaling.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void inversePre(float * z) {
+      const float g = 1.f / k_size;
+      const float x0 = z[0];
+      const float xm = z[1];
+      z[0] = g * (x0 + xm);
+      z[1] = -g * (x0 - xm);
+
+      for (uint32_t k = 1; k <= k_complex_size / 2; ++k) {
+        const uint32_t m = k_complex_size - k;
+        const float xkr = z[2*k], xki = z[2*k+1];
+        const float xmr = z[2*m], xmi = z[2*m+1];
+
+        const float er = g * (xkr + xmr);
+        const float ei = g * (xki - xmi);
+        const float dr = g * (xkr - xmr);
+        const float di = g * (xki + xmi);
+
+        float c, s;
+        FFTTables::cossin(k << k_twiddle_shift, c, s);
+        const float orr = dr * c - di * s;
+        const float oi = dr * s + di * c;
+
+        z[2*m] = er + oi;
+        z[2*m+1] = ei - orr;
+        z[2*k] = er - oi;
+        z[2*k+1] = -(ei + orr);
+      }
+    }
+
+    /**
+     * Undo input conjugation of inversePre(), leaving N real samples.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void inversePost(float * z) {
+      for (uint32_t i = 1; i < k_size; i += 2)
+        z[i] = -z[i];
+    }
+
+  private:
+
+    enum {
+      k_odd = (SizeExp - 1) & 1,
+      k_twiddle_shift = 12 - SizeExp,
+    };
+
+    /**
+     * Twiddle-free first stage, used when log2(N/2) is odd.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void radix2(float * z) {
+      for (uint32_t j = 0; j < 2 * k_complex_size; j += 4) {
+        const float ar = z[j], ai = z[j+1];
+        const float br = z[j+2], bi = z[j+3];
+        z[j] = ar + br;
+        z[j+1] = ai + bi;
+        z[j+2] = ar - br;
+        z[j+3] = ai - bi;
+      }
+    }
+
+    /**
+     * Radix-4 stage combining four size h transforms into size 4h transforms.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void radix4(float * z, const uint32_t h) {
+      // W_4h^k = exp(-2*pi*i*k/4h)
+      const uint32_t stride = FFTTables::k_quarter / h;
+      for (uint32_t k = 0; k < h; ++k) {
+        float c1, s1, c2, s2, c3, s3;
+        FFTTables::cossin(k * stride, c1, s1);
+        FFTTables::cossin(2 * k * stride, c2, s2);
+        FFTTables::cossin(3 * k * stride, c3, s3);
+
+        for (uint32_t j = k; j < k_complex_size; j += 4 * h) {
+          float * a = z + 2 * j;
+          float * b = a + 2 * h;
+          float * c = b + 2 * h;
+          float * d = c + 2 * h;
+
+          const float tbr = b[0] * c2 + b[1] * s2, tbi = b[1] * c2 - b[0] * s2;
+          const float tcr = c[0] * c1 + c[1] * s1, tci = c[1] * c1 - c[0] * s1;
+          const float tdr = d[0] * c3 + d[1] * s3, tdi = d[1] * c3 - d[0] * s3;
+
+          const float s0r = a[0] + tbr, s0i = a[1] + tbi;
+          const float d0r = a[0] - tbr, d0i = a[1] - tbi;
+          const float s1r = tcr + tdr, s1i = tci + tdi;
+          const float d1r = tcr - tdr, d1i = tci - tdi;
+
+          a[0] = s0r + s1r; a[1] = s0i + s1i;
+          c[0] = s0r - s1r; c[1] = s0i - s1i;
+          // -i * (d1r + i d1i) = d1i - i d1r
+          b[0] = d0r + d1i; b[1] = d0i - d1r;
+          d[0] = d0r - d1i; d[1] = d0i + d1r;
+        }
+      }
+    }
+
+  };
+
+}
+
+/** @} */
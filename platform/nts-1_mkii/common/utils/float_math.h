@@ -824,7 +824,6 @@ float fasterdbampf(const float db) {
 
 /**
  * @name    Interpolations
- * @todo    Add cubic/spline interpolations
  * @{
  */
 
@@ -843,6 +842,40 @@ float cosintf(const float fr, const float x0, const float x1) {
   return x0 + tmp * (x1 - x0);
 }
 
+/** 4-point, 3rd-order Hermite interpolation
+ *
+ * @param fr Fractional position between x0 and x1, in [0, 1)
+ * @param xm1 Sample preceding x0
+ * @param x0 First sample of interpolated interval
+ * @param x1 Second sample of interpolated interval
+ * @param x2 Sample following x1
+ */
+static inline __attribute__((optimize("Ofast"), always_inline))
+float hermiteintf(const float fr, const float xm1, const float x0, const float x1, const float x2) {
+  const float c1 = 0.5f * (x1 - xm1);
+  const float c2 = xm1 - 2.5f * x0 + 2.f * x1 - 0.5f * x2;
+  const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+  return ((c3 * fr + c2) * fr + c1) * fr + x0;
+}
+
+/** 4-point, 3rd-order Lagrange interpolation
+ *
+ * @param fr Fractional position between x0 and x1, in [0, 1)
+ * @param xm1 Sample preceding x0
+ * @param x0 First sample of interpolated interval
+ * @param x1 Second sample of interpolated interval
+ * @param x2 Sample following x1
+ */
+static inline __attribute__((optimize("Ofast"), always_inline))
+float lagrangeintf(const float fr, const float xm1, const float x0, const float x1, const float x2) {
+  const float dp1 = fr + 1.f;
+  const float dm1 = fr - 1.f;
+  const float dm2 = fr - 2.f;
+  const float a = fr * dm1;
+  const float b = dp1 * dm2;
+  return 0.5f * b * (dm1 * x0 - fr * x1) + (1.f/6.f) * a * (dp1 * x2 - dm2 * xm1);
+}
+
 /** @} */
 
 #endif // __float_math_h
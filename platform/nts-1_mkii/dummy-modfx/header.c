@@ -50,7 +50,7 @@ const __unit_header unit_header_t unit_header = {
     .unit_id = 0x0U,                                       // ID for this unit. Scoped within the context of a given dev_id.
     .version = 0x00010000U,                                // This unit's version: major.minor.patch (major<<16 minor<<8 patch).
     .name = "dummy",                                       // Name for this unit, will be displayed on device
-    .num_params = 3,                                       // Number of valid parameter descriptors. (max. 10)
+    .num_params = 4,                                       // Number of valid parameter descriptors. (max. 10)
     
     .params = {
         // Format: min, max, center, default, type, frac. bits, frac. mode, <reserved>, name
@@ -65,8 +65,8 @@ const __unit_header unit_header_t unit_header = {
         {0, 1023, 0, 256, k_unit_param_type_none, 1, 0, 0, {"DPTH"}},
 
         // 8 Edit menu parameters
-        {0, 3, 0, 1, k_unit_param_type_strings, 0, 0, 0, {"PARAM3"}}, // Example of a strings type parameter
-        {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
+        {3, 6, 0, 3, k_unit_param_type_none, 0, 0, 0, {"VOICES"}},
+        {-1000, 1000, 0, 0, k_unit_param_type_drywet, 1, 1, 0, {"MIX"}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
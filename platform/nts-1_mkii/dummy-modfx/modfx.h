@@ -37,6 +37,8 @@
  *
  *  Dummy modulation effect template instance.
  *
+ *  Multi-voice chorus/ensemble built on dsp::Chorus.
+ *
  */
 
 #include <atomic>
@@ -49,6 +51,8 @@
 #include "utils/buffer_ops.h" // for buf_clr_f32()
 #include "utils/int_math.h"   // for clipminmaxi32()
 
+#include "dsp/chorus.hpp"
+
 class Modfx {
  public:
   /*===========================================================================*/
@@ -62,7 +66,8 @@ class Modfx {
   enum {
     TIME = 0U,
     DEPTH,
-    PARAM3, 
+    VOICES,
+    MIX,
     NUM_PARAMS
   };
 
@@ -70,21 +75,28 @@ class Modfx {
   struct Params {
     float time{0.25f};
     float depth{0.25f};
-    uint32_t param3{1};
+    uint32_t voices{3};
+    float mix{0.f};
 
     void reset() {
       time = 0.25f;
       depth = 0.25f;
-      param3 = 1;
+      voices = 3;
+      mix = 0.f;
     }
   };
 
   enum {
-    PARAM3_VALUE0 = 0,
-    PARAM3_VALUE1,
-    PARAM3_VALUE2,
-    PARAM3_VALUE3,
-    NUM_PARAM3_VALUES,
+    k_min_voices = 3,
+    k_max_voices = 6,
+  };
+
+  enum {
+    k_flags_none  = 0,
+    k_flag_time   = 1<<0,
+    k_flag_depth  = 1<<1,
+    k_flag_voices = 1<<2,
+    k_flags_all   = k_flag_time | k_flag_depth | k_flag_voices,
   };
 
   /*===========================================================================*/
@@ -125,12 +137,18 @@ class Modfx {
     buf_clr_f32(m, BUFFER_LENGTH);
 
     allocated_buffer_ = m;
+
+    // Delay line holds interleaved stereo pairs
+    chorus_.setSamplingRate(1.f / 48000.f);
+    chorus_.setMemory((f32pair_t *)m, BUFFER_LENGTH / 2);
+    chorus_.setDelay(k_center_delay, k_voice_spread);
     
     // Cache the runtime descriptor for later use
     runtime_desc_ = *desc;
 
     // Make sure parameters are reset to default values
     params_.reset();
+    flags_ = k_flags_all;
     
     return k_unit_err_none;
   }
@@ -143,6 +161,7 @@ class Modfx {
 
   inline void Reset() {
     // Note: Reset effect state, excluding exposed parameter values.
+    chorus_.clear();
   }
 
   inline void Resume() {
@@ -165,17 +184,37 @@ class Modfx {
   fast_inline void Process(const float * in, float * out, size_t frames) {
     const float * __restrict in_p = in;
     float * __restrict out_p = out;
-    const float * out_e = out_p + (frames << 1);  // assuming stereo output
+
+    // Apply parameter changes at block boundary, depth changes are ramped by the chorus itself.
+    // Note: flags are taken before caching parameter values, so that a change landing in between
+    //       is either seen now or flagged again for the next block.
+    const uint32_t flags = flags_.exchange(k_flags_none, std::memory_order_acquire);
 
     // Caching current parameter values. Consider interpolating sensitive parameters.
-    // const Params p = params_;
-    
-    for (; out_p != out_e; in_p += 2, out_p += 2) {
-      // Process samples here
-      
-      // Note: this is a dummy unit only to demonstrate APIs, only passing through audio
-      out_p[0] = in_p[0]; // left sample
-      out_p[1] = in_p[1]; // right sample
+    const Params p = params_;
+
+    if (flags)
+      updateChorus(flags, p);
+
+    // Bipolar dry/wet, -1.0 fully dry, 1.0 fully wet
+    const float wet = 0.5f * (p.mix + 1.f);
+    const float dry = 1.f - wet;
+
+    float wet_buf[2 * k_max_chunk_frames];
+
+    while (frames) {
+      const size_t chunk = (frames < k_max_chunk_frames) ? frames : (size_t)k_max_chunk_frames;
+
+      chorus_.process(in_p, wet_buf, chunk);
+
+      const float * __restrict w_p = wet_buf;
+      const float * out_e = out_p + (chunk << 1);  // assuming stereo output
+      for (; out_p != out_e; in_p += 2, out_p += 2, w_p += 2) {
+        out_p[0] = dry * in_p[0] + wet * w_p[0]; // left sample
+        out_p[1] = dry * in_p[1] + wet * w_p[1]; // right sample
+      }
+
+      frames -= chunk;
     }
   }
 
@@ -185,18 +224,27 @@ class Modfx {
       // 10bit 0-1023 parameter
       value = clipminmaxi32(0, value, 1023);
       params_.time = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
+      flags_.fetch_or(k_flag_time);
       break;
 
     case DEPTH:
       // 10bit 0-1023 parameter
       value = clipminmaxi32(0, value, 1023);
       params_.depth = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
+      flags_.fetch_or(k_flag_depth);
+      break;
+
+    case VOICES:
+      // Number of taps per channel
+      value = clipminmaxi32(k_min_voices, value, k_max_voices);
+      params_.voices = value;
+      flags_.fetch_or(k_flag_voices);
       break;
 
-    case PARAM3:
-      // strings type parameter, receiving index value
-      value = clipminmaxi32(PARAM3_VALUE0, value, NUM_PARAM3_VALUES-1);
-      params_.param3 = value;
+    case MIX:
+      // Single digit base-10 fractional value, bipolar dry/wet
+      value = clipminmaxi32(-1000, value, 1000);
+      params_.mix = value / 1000.f; // -100.0 .. 100.0 -> -1.0 .. 1.0
       break;
       
     default:
@@ -216,9 +264,13 @@ class Modfx {
       return param_f32_to_10bit(params_.depth);
       break;
 
-    case PARAM3:
-      // strings type parameter, return index value
-      return params_.param3;
+    case VOICES:
+      return params_.voices;
+
+    case MIX:
+      // Single digit base-10 fractional value, bipolar dry/wet
+      return (int32_t)(params_.mix * 1000);
+      break;
 
     default:
       break;
@@ -231,23 +283,8 @@ class Modfx {
     // Note: String memory must be accessible even after function returned.
     //       It can be assumed that caller will have copied or used the string
     //       before the next call to getParameterStrValue
-    
-    static const char * param3_strings[NUM_PARAM3_VALUES] = {
-      "VAL 0",
-      "VAL 1",
-      "VAL 2",
-      "VAL 3",
-    };
-    
-    switch (index) {
-    case PARAM3:
-      if (value >= PARAM3_VALUE0 && value < NUM_PARAM3_VALUES)
-        return param3_strings[value];
-      break;
-    default:
-      break;
-    }
-    
+    (void)index;
+    (void)value;
     return nullptr;
   }
 
@@ -276,12 +313,35 @@ class Modfx {
   Params params_;
   
   float * allocated_buffer_;
+
+  dsp::Chorus chorus_;
   
   /*===========================================================================*/
   /* Private Methods. */
   /*===========================================================================*/
 
+  inline void updateChorus(const uint32_t flags, const Params & p) {
+    if (flags & k_flag_voices)
+      chorus_.setVoices(p.voices);
+    if (flags & k_flag_time) {
+      // 0.0 .. 1.0 -> 0.05Hz .. 8Hz, exponent kept negative for fastpow2f()
+      chorus_.setRate(8.f * fastpow2f((p.time - 1.f) * 7.321928f));
+    }
+    if (flags & k_flag_depth) {
+      // 0.0 .. 1.0 -> 0 .. 4ms peak excursion
+      chorus_.setDepth(p.depth * k_max_depth);
+    }
+  }
+
   /*===========================================================================*/
   /* Constants. */
   /*===========================================================================*/
+
+  enum {
+    k_max_chunk_frames = 64,
+  };
+
+  static constexpr float k_center_delay = 0.007f * 48000.f;  // 7ms
+  static constexpr float k_voice_spread = 0.0013f * 48000.f; // 1.3ms between voices
+  static constexpr float k_max_depth = 0.004f * 48000.f;     // 4ms
 };
@@ -69,7 +69,7 @@ const __unit_header unit_header_t unit_header = {
 
         // 8 Edit menu parameters
         // Example of a strings type parameter
-        {0, 3, 0, 1, k_unit_param_type_strings, 0, 0, 0, {"PARAM4"}}, // Example of a strings type parameter
+        {0, 3, 0, 1, k_unit_param_type_strings, 0, 0, 0, {"TYPE"}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
         {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
@@ -37,6 +37,8 @@
  *
  *  Dummy reverb effect template instance.
  *
+ *  Feedback delay network reverb built on dsp::FDNReverb.
+ *
  */
 
 #include <atomic>
@@ -49,6 +51,8 @@
 #include "utils/buffer_ops.h" // for buf_clr_f32()
 #include "utils/int_math.h"   // for clipminmaxi32()
 
+#include "dsp/fdnreverb.hpp"
+
 class Reverb {
  public:
   /*===========================================================================*/
@@ -63,7 +67,7 @@ class Reverb {
     TIME = 0U,
     DEPTH,
     MIX,
-    PARAM4, 
+    TYPE, 
     NUM_PARAMS
   };
 
@@ -72,22 +76,30 @@ class Reverb {
     float time{0.25f};
     float depth{0.25f};
     float mix{0.f};
-    uint32_t param4{1};
+    uint32_t type{1};
 
     void reset() {
       time = 0.25f;
       depth = 0.25f;
       mix = 0.f;
-      param4 = 1;
+      type = 1;
     }
   };
 
   enum {
-    PARAM4_VALUE0 = 0,
-    PARAM4_VALUE1,
-    PARAM4_VALUE2,
-    PARAM4_VALUE3,
-    NUM_PARAM4_VALUES,
+    TYPE_ROOM = 0,
+    TYPE_HALL,
+    TYPE_PLATE,
+    TYPE_SPACE,
+    NUM_TYPE_VALUES,
+  };
+
+  enum {
+    k_flags_none = 0,
+    k_flag_time  = 1<<0,
+    k_flag_depth = 1<<1,
+    k_flag_type  = 1<<2,
+    k_flags_all  = k_flag_time | k_flag_depth | k_flag_type,
   };
   
   /*===========================================================================*/
@@ -128,12 +140,17 @@ class Reverb {
     buf_clr_f32(m, BUFFER_LENGTH);
 
     allocated_buffer_ = m;
+
+    // Lay out all reverb lines in the allocated arena
+    reverb_.setSamplingRate(1.f / 48000.f);
+    reverb_.setMemory(m, BUFFER_LENGTH / dsp::FDNReverb::k_num_lines);
     
     // Cache the runtime descriptor for later use
     runtime_desc_ = *desc;
 
     // Make sure parameters are reset to default values
     params_.reset();
+    flags_ = k_flags_all;
     
     return k_unit_err_none;
   }
@@ -146,6 +163,7 @@ class Reverb {
 
   inline void Reset() {
     // Note: Reset effect state, excluding exposed parameter values.
+    reverb_.clear();
   }
 
   inline void Resume() {
@@ -168,17 +186,37 @@ class Reverb {
   fast_inline void Process(const float * in, float * out, size_t frames) {
     const float * __restrict in_p = in;
     float * __restrict out_p = out;
-    const float * out_e = out_p + (frames << 1);  // assuming stereo output
+
+    // Apply parameter changes at block boundary, coefficient updates are kept off the per-sample path.
+    // Note: flags are taken before caching parameter values, so that a change landing in between
+    //       is either seen now or flagged again for the next block.
+    const uint32_t flags = flags_.exchange(k_flags_none, std::memory_order_acquire);
 
     // Caching current parameter values. Consider interpolating sensitive parameters.
-    // const Params p = params_;
-    
-    for (; out_p != out_e; in_p += 2, out_p += 2) {
-      // Process samples here
-      
-      // Note: this is a dummy unit only to demonstrate APIs, only passing through audio
-      out_p[0] = in_p[0]; // left sample
-      out_p[1] = in_p[1]; // right sample
+    const Params p = params_;
+
+    if (flags)
+      updateReverb(flags, p);
+
+    // Bipolar dry/wet, -1.0 fully dry, 1.0 fully wet
+    const float wet = 0.5f * (p.mix + 1.f);
+    const float dry = 1.f - wet;
+
+    float wet_buf[2 * k_max_chunk_frames];
+
+    while (frames) {
+      const size_t chunk = (frames < k_max_chunk_frames) ? frames : (size_t)k_max_chunk_frames;
+
+      reverb_.process(in_p, wet_buf, chunk);
+
+      const float * __restrict w_p = wet_buf;
+      const float * out_e = out_p + (chunk << 1);  // assuming stereo output
+      for (; out_p != out_e; in_p += 2, out_p += 2, w_p += 2) {
+        out_p[0] = dry * in_p[0] + wet * w_p[0]; // left sample
+        out_p[1] = dry * in_p[1] + wet * w_p[1]; // right sample
+      }
+
+      frames -= chunk;
     }
   }
 
@@ -188,12 +226,14 @@ class Reverb {
       // 10bit 0-1023 parameter
       value = clipminmaxi32(0, value, 1023);
       params_.time = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
+      flags_.fetch_or(k_flag_time);
       break;
 
     case DEPTH:
       // 10bit 0-1023 parameter
       value = clipminmaxi32(0, value, 1023);
       params_.depth = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
+      flags_.fetch_or(k_flag_depth);
       break;
 
     case MIX:
@@ -202,10 +242,11 @@ class Reverb {
       params_.mix = value / 1000.f; // -100.0 .. 100.0 -> -1.0 .. 1.0
       break;
 
-    case PARAM4:
+    case TYPE:
       // strings type parameter, receiving index value
-      value = clipminmaxi32(PARAM4_VALUE0, value, NUM_PARAM4_VALUES-1);
-      params_.param4 = value;
+      value = clipminmaxi32(TYPE_ROOM, value, NUM_TYPE_VALUES-1);
+      params_.type = value;
+      flags_.fetch_or(k_flag_type);
       break;
       
     default:
@@ -230,9 +271,9 @@ class Reverb {
       return (int32_t)(params_.mix * 1000);
       break;
 
-    case PARAM4:
+    case TYPE:
       // strings type parameter, return index value
-      return params_.param4;
+      return params_.type;
 
     default:
       break;
@@ -246,17 +287,17 @@ class Reverb {
     //       It can be assumed that caller will have copied or used the string
     //       before the next call to getParameterStrValue
     
-    static const char * param4_strings[NUM_PARAM4_VALUES] = {
-      "VAL 0",
-      "VAL 1",
-      "VAL 2",
-      "VAL 3",
+    static const char * type_strings[NUM_TYPE_VALUES] = {
+      "ROOM",
+      "HALL",
+      "PLATE",
+      "SPACE",
     };
     
     switch (index) {
-    case PARAM4:
-      if (value >= PARAM4_VALUE0 && value < NUM_PARAM4_VALUES)
-        return param4_strings[value];
+    case TYPE:
+      if (value >= TYPE_ROOM && value < NUM_TYPE_VALUES)
+        return type_strings[value];
       break;
     default:
       break;
@@ -290,12 +331,47 @@ class Reverb {
   Params params_;
   
   float * allocated_buffer_;
+
+  dsp::FDNReverb reverb_;
   
   /*===========================================================================*/
   /* Private Methods. */
   /*===========================================================================*/
 
+  inline void updateReverb(const uint32_t flags, const Params & p) {
+    if (flags & k_flag_type) {
+      // Per type: size, modulation depth, modulation rate, feedback matrix
+      static const struct {
+        float size;
+        float mod_depth;
+        float mod_rate;
+        uint32_t matrix;
+      } types[NUM_TYPE_VALUES] = {
+        {0.6f, 0.1f, 0.7f, dsp::FDNReverb::k_matrix_hadamard},     // ROOM
+        {1.8f, 0.3f, 0.4f, dsp::FDNReverb::k_matrix_hadamard},     // HALL
+        {1.0f, 0.2f, 1.1f, dsp::FDNReverb::k_matrix_householder},  // PLATE
+        {3.5f, 0.6f, 0.25f, dsp::FDNReverb::k_matrix_hadamard},    // SPACE
+      };
+      const uint32_t t = (p.type < NUM_TYPE_VALUES) ? p.type : (uint32_t)TYPE_HALL;
+      reverb_.setSize(types[t].size);
+      reverb_.setModulation(types[t].mod_depth, types[t].mod_rate);
+      reverb_.setMatrix(types[t].matrix);
+    }
+    if (flags & (k_flag_time | k_flag_type)) {
+      // 0.0 .. 1.0 -> 0.3s .. 12s RT60, exponent kept negative for fastpow2f()
+      reverb_.setDecay(12.f * fastpow2f((p.time - 1.f) * 5.321928f));
+    }
+    if (flags & k_flag_depth) {
+      // Depth controls high frequency damping
+      reverb_.setDamping(0.05f + 0.8f * p.depth);
+    }
+  }
+
   /*===========================================================================*/
   /* Constants. */
   /*===========================================================================*/
+
+  enum {
+    k_max_chunk_frames = 64,
+  };
 };
@@ -49,6 +49,9 @@
 #include "waves_common.h"
 
 #include "dsp/biquad.hpp"
+#include "dsp/oversampler.hpp"
+#include "dsp/mipwavetable.hpp"
+#include "dsp/smoothed.hpp"
 
 class Waves {
 public:
@@ -112,8 +115,9 @@ public:
     float                     w0_a;          // wave a phase increment
     float                     w0_b;          // wave b phase increment
     float                     w0_sub;        // sub wave phase increment
-    float                     lfo;           // target lfo value
-    float                     lfoz;          // current interpolated lfo value
+    dsp::Smoothed<float>      lfo;           // lfo value, ramped over each block
+    dsp::Smoothed<float>      sub_mix;       // sub wave mix, ramped over each block
+    dsp::Smoothed<float>      ring_mix;      // ring modulation mix, ramped over each block
     float                     dither;        // dithering amount before bit reduction
     float                     bit_res;       // bit depth scaling factor
     float                     bit_res_recip; // bit depth scaling reciprocal, returns signal to 0.-1.f after scaling/rounding
@@ -127,8 +131,6 @@ public:
       w0_a(440.f * k_samplerate_recipf),
       w0_b(440.f * k_samplerate_recipf),
       w0_sub(220.f * k_samplerate_recipf),
-      lfo(0.f),
-      lfoz(0.f),
       dither(0.f),
       bit_res(1.f),
       bit_res_recip(1.f),
@@ -142,7 +144,7 @@ public:
       phi_a = 0;
       phi_b = 0;
       phi_sub = 0;
-      lfo = lfoz;
+      lfo.setValue(lfo.getValue());
     }
   };
 
@@ -183,6 +185,9 @@ public:
     
     // Make sure parameters are reset to default values
     params_.reset();
+
+    // Build band-limited mipmaps for default wave selection
+    updateWaves(State::k_flag_wave_a | State::k_flag_wave_b | State::k_flag_sub_wave);
     
     return k_unit_err_none;
   }
@@ -223,12 +228,20 @@ public:
       updatePitch(osc_w0f_for_note((ctxt->pitch)>>8, ctxt->pitch & 0xFF));
 
       const uint32_t flags = s.flags.exchange(State::k_flags_none, std::memory_order_relaxed);
-      updateWaves(flags);
+
+      // Rebuilding a mipmap is costly, handle one wave change per block and defer the others
+      const uint32_t wave_flags = flags & (State::k_flag_wave_a | State::k_flag_wave_b | State::k_flag_sub_wave);
+      const uint32_t wave_flag = wave_flags & (~wave_flags + 1);
+      if (wave_flags != wave_flag)
+        s.flags.fetch_or(wave_flags ^ wave_flag);
+      updateWaves(wave_flag);
       
       if (flags & State::k_flag_reset)
         s.Reset();
       
-      s.lfo = q31_to_f32(ctxt->shape_lfo);
+      s.lfo.setTarget(q31_to_f32(ctxt->shape_lfo));
+      s.sub_mix.setTarget(p.sub_mix * 0.5011872336272722f);
+      s.ring_mix.setTarget(p.ring_mix);
       
       if (flags & State::k_flag_bit_crush) {
         s.dither = p.bit_crush * 2e-008f;
@@ -241,34 +254,38 @@ public:
     float phi_a = s.phi_a;
     float phi_b = s.phi_b;
     float phi_sub = s.phi_sub;
+
+    // Select mipmap levels once per block, crossfading toward the next octave
+    uint32_t lvl_a, lvl_b, lvl_sub;
+    float xfade_a, xfade_b, xfade_sub;
+    WaveMip::selectLevel(s.w0_a, lvl_a, xfade_a);
+    WaveMip::selectLevel(s.w0_b, lvl_b, xfade_b);
+    WaveMip::selectLevel(s.w0_sub, lvl_sub, xfade_sub);
+    const float * wave_a0 = mip_a_.level(lvl_a);
+    const float * wave_a1 = mip_a_.level(lvl_a + 1);
+    const float * wave_b0 = mip_b_.level(lvl_b);
+    const float * wave_b1 = mip_b_.level(lvl_b + 1);
+    const float * sub_wave0 = mip_sub_.level(lvl_sub);
+    const float * sub_wave1 = mip_sub_.level(lvl_sub + 1);
     
-    float lfoz = s.lfoz;
-    const float lfo_inc = (s.lfo - lfoz) / frames;
-    
-    const float ditheramt = p.bit_crush * 2e-008f;
-        
-    const float sub_mix = p.sub_mix * 0.5011872336272722f;
-    const float ring_mix = p.ring_mix;
+    float lfo_inc, sub_mix_inc, ring_mix_inc;
+    float lfoz = s.lfo.ramp(frames, lfo_inc);
+    float sub_mix = s.sub_mix.ramp(frames, sub_mix_inc);
+    float ring_mix = s.ring_mix.ramp(frames, ring_mix_inc);
     
-    float * __restrict y = out;
+    float * y = out;
     const float * y_e = y + frames;
   
     for (; y != y_e; ) {
       const float wave_mix = clip01f(p.shape+lfoz);
       
-      float sig = (1.f - wave_mix) * osc_wave_scanf(s.wave_a, phi_a);
-      sig += wave_mix * osc_wave_scanf(s.wave_b, phi_b);
+      float sig = (1.f - wave_mix) * WaveMip::read(wave_a0, wave_a1, xfade_a, phi_a);
+      sig += wave_mix * WaveMip::read(wave_b0, wave_b1, xfade_b, phi_b);
     
-      const float sub_sig = osc_wave_scanf(s.sub_wave, phi_sub);
+      const float sub_sig = WaveMip::read(sub_wave0, sub_wave1, xfade_sub, phi_sub);
       sig = (1.f - ring_mix) * sig + ring_mix * 1.4125375446227544f * (sub_sig * sig);
       sig += sub_mix * sub_sig;
       sig *= 1.4125375446227544f;
-      sig = clip1m1f(fastertanh2f(sig));
-    
-      sig = prelpf_.process_fo(sig);
-      sig += s.dither * osc_white();
-      sig = si_roundf(sig * s.bit_res) * s.bit_res_recip;
-      sig = postlpf_.process_fo(sig);
       
       *(y++) = sig;
     
@@ -279,13 +296,27 @@ public:
       phi_sub += s.w0_sub;
       phi_sub -= (uint32_t)phi_sub;
       lfoz += lfo_inc;
+      sub_mix += sub_mix_inc;
+      ring_mix += ring_mix_inc;
     }
 
+    // Nonlinear stages run at 2x rate so that their harmonics do not fold back
+    sat_os_.process(out, out, frames, [](float x) { return clip1m1f(fastertanh2f(x)); });
+
+    for (y = out; y != y_e; ++y)
+      *y = prelpf_.process_fo(*y) + s.dither * osc_white();
+
+    const float bit_res = s.bit_res;
+    const float bit_res_recip = s.bit_res_recip;
+    crush_os_.process(out, out, frames, [bit_res, bit_res_recip](float x) { return si_roundf(x * bit_res) * bit_res_recip; });
+
+    for (y = out; y != y_e; ++y)
+      *y = postlpf_.process_fo(*y);
+
     // Update state
     s.phi_a = phi_a;
     s.phi_b = phi_b;
     s.phi_sub = phi_sub;
-    s.lfoz = lfoz;
   }
 
   inline void setParameter(uint8_t index, int32_t value) {
@@ -456,10 +487,14 @@ public:
   /*===========================================================================*/
   /* Private Member Variables. */
   /*===========================================================================*/
+
+  typedef dsp::MipWavetable<k_waves_size_exp> WaveMip;
   
   State       state_;
   Params      params_;
   dsp::BiQuad prelpf_, postlpf_;
+  dsp::Oversampler<2> sat_os_, crush_os_;
+  WaveMip     mip_a_, mip_b_, mip_sub_;
   unit_runtime_desc_t runtime_desc_;
   
   /*===========================================================================*/
@@ -497,6 +532,7 @@ public:
         idx -= k_b_thr;
       }
       state_.wave_a = table[idx];
+      mip_a_.build(state_.wave_a);
     }
     if (flags & State::k_flag_wave_b) {
       static const uint8_t k_d_thr = k_waves_d_cnt;
@@ -519,10 +555,12 @@ public:
       }
       
       state_.wave_b = table[idx];
+      mip_b_.build(state_.wave_b);
     }
     if (flags & State::k_flag_sub_wave) {
       const uint8_t idx = params_.sub_wave;
       state_.sub_wave = wavesA[params_.sub_wave];
+      mip_sub_.build(state_.sub_wave);
     }
   }
   
@@ -0,0 +1,398 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    blosc.hpp
+ * @brief   PolyBLEP/PolyBLAMP band-limited oscillator.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Band-limited oscillator using polynomial corrections around discontinuities.
+   *
+   * Saw and pulse edges are smoothed with a two-sample PolyBLEP residual, the
+   * triangle corners with the matching PolyBLAMP residual. Cost is constant per
+   * sample regardless of pitch, and no tables are required.
+   *
+   * Phase is an unsigned 32-bit accumulator where a full cycle spans 2^32.
+   */
+  struct BLOsc {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_shape_saw = 0,
+      k_shape_pulse,
+      k_shape_triangle,
+      k_num_shapes
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    BLOsc(void) :
+      mPhase(0),
+      mW0(0),
+      mPW(0x80000000),
+      mShape(k_shape_saw),
+      mZ(0.f)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Reset phase and sync state
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void reset(void)
+    {
+      mPhase = 0;
+      mZ = 0.f;
+    }
+
+    /**
+     * Set waveform shape
+     *
+     * @param shape One of k_shape_saw, k_shape_pulse, k_shape_triangle
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setShape(const uint32_t shape)
+    {
+      mShape = (shape < k_num_shapes) ? shape : (uint32_t)k_shape_saw;
+    }
+
+    /**
+     * Set oscillator frequency
+     *
+     * @param f0 Frequency in Hz
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setF0(const float f0, const float fsrecip)
+    {
+      setW0(f0 * fsrecip);
+    }
+
+    /**
+     * Set normalized oscillator frequency
+     *
+     * @param w Frequency in cycles per sample, clipped to [0, 0.5)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setW0(const float w)
+    {
+      const float wc = (w < 0.f) ? 0.f : (w > 0.499f) ? 0.499f : w;
+      mW0 = (uint32_t)(wc * 4294967296.f);
+    }
+
+    /**
+     * Set pulse width, only used by pulse shape
+     *
+     * @param pw Duty cycle, clipped to [0.01, 0.99]
+     *
+     * @note Can be called once per block for pulse width modulation.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setPulseWidth(const float pw)
+    {
+      const float pwc = (pw < 0.01f) ? 0.01f : (pw > 0.99f) ? 0.99f : pw;
+      mPW = (uint32_t)(pwc * 4294967296.f);
+    }
+
+    /**
+     * Render next sample
+     *
+     * @return Output sample in [-1, 1]
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float process(void)
+    {
+      const float dt = mW0 * k_phase_scale;
+      float y;
+      switch (mShape) {
+      case k_shape_pulse:
+        y = pulse(mPhase, mPW, dt);
+        break;
+      case k_shape_triangle:
+        y = triangle(mPhase, dt);
+        break;
+      default:
+        y = saw(mPhase, dt);
+        break;
+      }
+      mPhase += mW0;
+      return y;
+    }
+
+    /**
+     * Render a block of samples
+     *
+     * @param out Destination buffer
+     * @param frames Number of samples to render
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void render(float * __restrict out, size_t frames)
+    {
+      uint32_t phase = mPhase;
+      const uint32_t w0 = mW0;
+      const float dt = w0 * k_phase_scale;
+
+      switch (mShape) {
+      case k_shape_pulse:
+        {
+          const uint32_t pw = mPW;
+          for (size_t i = 0; i < frames; ++i, phase += w0)
+            out[i] = pulse(phase, pw, dt);
+        }
+        break;
+      case k_shape_triangle:
+        for (size_t i = 0; i < frames; ++i, phase += w0)
+          out[i] = triangle(phase, dt);
+        break;
+      default:
+        for (size_t i = 0; i < frames; ++i, phase += w0)
+          out[i] = saw(phase, dt);
+        break;
+      }
+
+      mPhase = phase;
+    }
+
+    /**
+     * Render a block of samples and report cycle starts for hard sync.
+     *
+     * @param out Destination buffer
+     * @param sync Destination buffer for sync events, receives for each sample the
+     *             time elapsed since the cycle started, as a fraction of a sample
+     *             in [0, 1), or -1 if no cycle started since the previous sample.
+     * @param frames Number of samples to render
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void renderMaster(float * __restrict out, float * __restrict sync, size_t frames)
+    {
+      const uint32_t w0 = mW0;
+      const float w0recip = (w0) ? 1.f / w0 : 0.f;
+
+      render(out, frames);
+
+      // Phase of sample i is smaller than w0 only if the increment leading to it wrapped
+      uint32_t phase = mPhase - frames * w0;
+      for (size_t i = 0; i < frames; ++i, phase += w0)
+        sync[i] = (phase < w0) ? phase * w0recip : -1.f;
+    }
+
+    /**
+     * Render a block of samples hard synced to another oscillator.
+     *
+     * @param out Destination buffer
+     * @param sync Sync events as written by renderMaster() of the master oscillator
+     * @param frames Number of samples to render
+     *
+     * @note Output is delayed by one sample so that the discontinuity caused by a
+     *       phase reset can be corrected on both sides.
+     * @note Only the step caused by a reset is corrected, not the slope change.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void renderSlave(float * __restrict out, const float * __restrict sync, size_t frames)
+    {
+      uint32_t phase = mPhase;
+      const uint32_t w0 = mW0;
+      const uint32_t pw = mPW;
+      const uint32_t shape = mShape;
+      const float dt = w0 * k_phase_scale;
+      float z = mZ;
+
+      for (size_t i = 0; i < frames; ++i, phase += w0) {
+        const float s = sync[i];
+        float y;
+        if (s >= 0.f) {
+          // Reset happened s samples ago, correct the step on both sides of it
+          const uint32_t reset_phase = (uint32_t)(s * w0);
+          const uint32_t prev_phase = phase - reset_phase;
+          phase = reset_phase;
+          const float h = naive(0, pw, shape) - naive(prev_phase, pw, shape);
+          const float r = 1.f - s;
+          z += 0.5f * h * s * s;
+          y = naive(phase, pw, shape) - 0.5f * h * r * r;
+        }
+        else {
+          switch (shape) {
+          case k_shape_pulse:
+            y = pulse(phase, pw, dt);
+            break;
+          case k_shape_triangle:
+            y = triangle(phase, dt);
+            break;
+          default:
+            y = saw(phase, dt);
+            break;
+          }
+        }
+        out[i] = z;
+        z = y;
+      }
+
+      mPhase = phase;
+      mZ = z;
+    }
+
+    /*===========================================================================*/
+    /* Static Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * PolyBLEP residual for a downward step of height 2 at phase 0
+     *
+     * @param t Phase in [0, 1)
+     * @param dt Phase increment per sample
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float polyblep(const float t, const float dt)
+    {
+      if (t < dt) {
+        const float x = t / dt;
+        return x + x - x * x - 1.f;
+      }
+      if (t > 1.f - dt) {
+        const float x = (t - 1.f) / dt;
+        return x * x + x + x + 1.f;
+      }
+      return 0.f;
+    }
+
+    /**
+     * PolyBLAMP residual for a unit slope increase per sample at phase 0
+     *
+     * @param t Phase in [0, 1)
+     * @param dt Phase increment per sample
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float polyblamp(const float t, const float dt)
+    {
+      if (t < dt) {
+        const float x = 1.f - t / dt;
+        return (1.f / 6.f) * x * x * x;
+      }
+      if (t > 1.f - dt) {
+        const float x = (t - 1.f) / dt + 1.f;
+        return (1.f / 6.f) * x * x * x;
+      }
+      return 0.f;
+    }
+
+    /**
+     * Band-limited saw, ramping up from -1 to 1
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float saw(const uint32_t phase, const float dt)
+    {
+      const float t = phase * k_phase_scale;
+      return 2.f * t - 1.f - polyblep(t, dt);
+    }
+
+    /**
+     * Band-limited pulse, high from phase 0 to pulse width
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float pulse(const uint32_t phase, const uint32_t pw, const float dt)
+    {
+      const float t = phase * k_phase_scale;
+      const float t2 = (phase - pw) * k_phase_scale;
+      const float y = (phase < pw) ? 1.f : -1.f;
+      return y + polyblep(t, dt) - polyblep(t2, dt);
+    }
+
+    /**
+     * Band-limited triangle, rising from -1 at phase 0 to 1 at phase 0.5
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float triangle(const uint32_t phase, const float dt)
+    {
+      const float t = phase * k_phase_scale;
+      const float t2 = (phase + 0x80000000U) * k_phase_scale;
+      const float y = (phase & 0x80000000U) ? 3.f - 4.f * t : 4.f * t - 1.f;
+      return y + 8.f * dt * (polyblamp(t, dt) - polyblamp(t2, dt));
+    }
+
+    /**
+     * Trivial waveform value, without band limiting
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float naive(const uint32_t phase, const uint32_t pw, const uint32_t shape)
+    {
+      const float t = phase * k_phase_scale;
+      switch (shape) {
+      case k_shape_pulse:
+        return (phase < pw) ? 1.f : -1.f;
+      case k_shape_triangle:
+        return (phase & 0x80000000U) ? 3.f - 4.f * t : 4.f * t - 1.f;
+      default:
+        return 2.f * t - 1.f;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    static constexpr float k_phase_scale = 1.f / 4294967296.f;
+
+    uint32_t mPhase;
+    uint32_t mW0;
+    uint32_t mPW;
+    uint32_t mShape;
+    float    mZ;
+  };
+}
+
+/** @} */
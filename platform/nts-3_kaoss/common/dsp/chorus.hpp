@@ -0,0 +1,310 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    chorus.hpp
+ * @brief   Multi-voice chorus and ensemble.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "utils/float_math.h"
+#include "dsp/delayline.hpp"
+#include "dsp/simplelfo.hpp"
+#include "dsp/smoothed.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Stereo chorus with several modulated taps per channel on a shared delay line.
+   *
+   * Each voice has one tap per channel, each tap with its own sine LFO. LFO phases
+   * are spread evenly across voices, right channel taps being offset by half a step
+   * from left channel taps. Voice center delays are also spread to decorrelate them.
+   *
+   * Modulation is rendered per block with SimpleLFO fills, and taps are read with
+   * 4-point Hermite interpolation. Since all tap positions lie within a known span,
+   * a single wrap check per frame decides whether taps can be read straight from
+   * memory or need masked indexing.
+   */
+  struct Chorus {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_max_voices = 6,   /**< Maximum number of voices, i.e.: taps per channel. */
+      k_max_frames = 64,  /**< Frames processed per internal chunk. */
+      k_min_delay = 2,    /**< Minimum read offset for Hermite reads. */
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    Chorus(void) :
+      mLine(),
+      mDepth(0.f),
+      mFsRecip(1.f / 48000.f),
+      mDelay(k_min_delay),
+      mSpread(0.f),
+      mGain(1.f),
+      mRate(0.5f),
+      mNumVoices(3)
+    {
+      setVoices(3);
+      setRate(mRate);
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set the memory area to use as backing buffer for the delay line.
+     *
+     * @param ram Pointer to memory buffer
+     * @param line_size Size in float pairs of memory buffer
+     *
+     * @note Will round size to next power of two. Longest tap delay is clipped to fit.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMemory(f32pair_t *ram, size_t line_size) {
+      mLine.setMemory(ram, line_size);
+    }
+
+    /**
+     * Zero clear the delay line.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void clear(void) {
+      mLine.clear();
+    }
+
+    /**
+     * Set sampling rate.
+     *
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setSamplingRate(const float fsrecip) {
+      mFsRecip = fsrecip;
+      setRate(mRate);
+    }
+
+    /**
+     * Set number of voices and spread LFO phases across them.
+     *
+     * @param voices Number of taps per channel, clipped to [1, k_max_voices]
+     *
+     * @note Resets LFO phases.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setVoices(uint32_t voices) {
+      voices = (voices < 1) ? 1 : (voices > k_max_voices) ? (uint32_t)k_max_voices : voices;
+      mNumVoices = voices;
+      mGain = 1.f / voices;
+
+      // Q32 phase step between voices, right taps sit halfway between left ones
+      const uint32_t step = (uint32_t)(4294967296.f / voices);
+      for (uint32_t v = 0; v < voices; ++v) {
+        mLfo[v].phi0 = (q31_t)(0x80000000U + v * step);
+        mLfo[k_max_voices + v].phi0 = (q31_t)(0x80000000U + v * step + (step >> 1));
+      }
+    }
+
+    /**
+     * Set modulation rate.
+     *
+     * @param hz LFO frequency in Hz
+     *
+     * @note Voices run at slightly detuned rates to avoid a static pattern.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setRate(const float hz) {
+      mRate = hz;
+      for (uint32_t v = 0; v < k_max_voices; ++v) {
+        const float f = hz * (1.f + 0.03f * v);
+        mLfo[v].setF0(f, mFsRecip);
+        mLfo[k_max_voices + v].setF0(f, mFsRecip);
+      }
+    }
+
+    /**
+     * Set base delay and spacing of voice delays.
+     *
+     * @param delay Center delay of first voice in samples
+     * @param spread Center delay increment between voices in samples
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDelay(const float delay, const float spread) {
+      mDelay = delay;
+      mSpread = spread;
+      const float max_delay = (float)mLine.mSize - 4.f;
+      if (mDelay + (k_max_voices - 1) * mSpread > max_delay)
+        mDelay = max_delay - (k_max_voices - 1) * mSpread;
+      if (mDelay < k_min_delay)
+        mDelay = k_min_delay;
+      setDepth(mDepth.getTarget());
+    }
+
+    /**
+     * Set modulation depth.
+     *
+     * @param depth Peak delay excursion in samples, clipped so taps stay in range
+     *
+     * @note Changes are ramped over 32ms worth of samples at 48kHz.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDepth(float depth) {
+      const float max_depth = mDelay - k_min_delay;
+      depth = clipminmaxf(0.f, depth, max_depth);
+      mDepth.setRampLength(1536);
+      mDepth.setTarget(depth);
+    }
+
+    /**
+     * Process a block of interleaved stereo samples, output is fully wet.
+     *
+     * @param in Input samples, interleaved stereo
+     * @param out Output samples, interleaved stereo, may be the same as in
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast")))
+    void process(const float * in, float * out, size_t frames) {
+      const f32pair_t * in_p = (const f32pair_t *)in;
+      f32pair_t * out_p = (f32pair_t *)out;
+
+      float mod[2 * k_max_voices][k_max_frames];
+      float center[k_max_voices];
+
+      const uint32_t voices = mNumVoices;
+      for (uint32_t v = 0; v < voices; ++v)
+        center[v] = mDelay + v * mSpread;
+
+      while (frames) {
+        const size_t n = (frames < k_max_frames) ? frames : (size_t)k_max_frames;
+
+        // Block rate modulation
+        for (uint32_t v = 0; v < voices; ++v) {
+          mLfo[v].fill_sine_bi(mod[v], n);
+          mLfo[k_max_voices + v].fill_sine_bi(mod[k_max_voices + v], n);
+        }
+
+        float depth_inc;
+        float depth = mDepth.ramp(n, depth_inc);
+        const float depth_max = (depth > mDepth.getValue()) ? depth : mDepth.getValue();
+
+        // Span covering all taps for the whole chunk, from first sample before
+        // the shortest tap to last sample after the longest one, with one sample margin
+        const uint32_t lo = (uint32_t)(mDelay - depth_max) - 1;
+        const uint32_t hi = (uint32_t)(center[voices - 1] + depth_max) + 1;
+        const uint32_t span = hi - lo + 3;
+
+        // Whole chunk must be written before taps are read
+        mLine.write(in_p, n);
+
+        const f32pair_t * __restrict line = mLine.mLine;
+        const uint32_t mask = mLine.mMask;
+        uint32_t head = mLine.mWriteIdx + n - 2 + lo;
+
+        for (size_t i = 0; i < n; ++i, --head, depth += depth_inc) {
+          const uint32_t start = head & mask;
+          float yl = 0.f, yr = 0.f;
+          if (start + span <= mask) {
+            // No wrap for any tap in this frame
+            const f32pair_t * __restrict p = line + start;
+            for (uint32_t v = 0; v < voices; ++v) {
+              const float pl = center[v] + depth * mod[v][i];
+              const float pr = center[v] + depth * mod[k_max_voices + v][i];
+              const uint32_t bl = (uint32_t)pl;
+              const uint32_t br = (uint32_t)pr;
+              const f32pair_t * __restrict ql = p + (bl - lo);
+              const f32pair_t * __restrict qr = p + (br - lo);
+              yl += hermiteintf(pl - bl, ql[0].a, ql[1].a, ql[2].a, ql[3].a);
+              yr += hermiteintf(pr - br, qr[0].b, qr[1].b, qr[2].b, qr[3].b);
+            }
+          }
+          else {
+            for (uint32_t v = 0; v < voices; ++v) {
+              const float pl = center[v] + depth * mod[v][i];
+              const float pr = center[v] + depth * mod[k_max_voices + v][i];
+              const uint32_t bl = (uint32_t)pl;
+              const uint32_t br = (uint32_t)pr;
+              const uint32_t il = start + (bl - lo);
+              const uint32_t ir = start + (br - lo);
+              yl += hermiteintf(pl - bl, line[il & mask].a, line[(il+1) & mask].a,
+                                line[(il+2) & mask].a, line[(il+3) & mask].a);
+              yr += hermiteintf(pr - br, line[ir & mask].b, line[(ir+1) & mask].b,
+                                line[(ir+2) & mask].b, line[(ir+3) & mask].b);
+            }
+          }
+          out_p[i].a = mGain * yl;
+          out_p[i].b = mGain * yr;
+        }
+
+        in_p += n;
+        out_p += n;
+        frames -= n;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DualDelayLine    mLine;
+    SimpleLFO        mLfo[2 * k_max_voices];
+    Smoothed<float>  mDepth;
+    float            mFsRecip;
+    float            mDelay;
+    float            mSpread;
+    float            mGain;
+    float            mRate;
+    uint32_t         mNumVoices;
+
+  };
+
+}
+
+/** @} */
@@ -0,0 +1,234 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    mipwavetable.hpp
+ * @brief   Octave mipmapped single cycle wavetable.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "utils/float_math.h"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Octave mipmap of a single cycle waveform.
+   *
+   * Level k contains the first (N/2)>>k harmonics of the source waveform, so that
+   * each level can be played one octave higher than the previous one without
+   * aliasing. Levels are built from the spectrum of the source cycle, each level
+   * stores one guard sample so that reads do not need to wrap.
+   *
+   * @tparam SizeExp Base 2 logarithm of the cycle length N
+   */
+  template <uint32_t SizeExp>
+  struct MipWavetable {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_size = 1U << SizeExp,
+      k_mask = k_size - 1,
+      k_num_harmonics = k_size >> 1,
+      k_num_levels = SizeExp,
+      k_level_size = k_size + 1
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    MipWavetable(void) {
+      clear();
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Zero clear all levels.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void clear(void) {
+      for (uint32_t k = 0; k < k_num_levels; ++k)
+        for (uint32_t i = 0; i < k_level_size; ++i)
+          mLevels[k][i] = 0.f;
+    }
+
+    /**
+     * Build all levels from a single cycle waveform.
+     *
+     * @param wave Source waveform, N samples
+     *
+     * @note Costs about N*N multiply-adds, should not be called on every audio block.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void build(const float * wave) {
+      // sin(2*pi*i/N) by rotation, cos is read a quarter cycle ahead
+      float sine[k_size];
+      {
+        const double delta = 6.283185307179586 / k_size;
+        const double cd = __builtin_cos(delta);
+        const double sd = __builtin_sin(delta);
+        double c = 1.0, s = 0.0;
+        for (uint32_t i = 0; i < k_size; ++i) {
+          sine[i] = (float)s;
+          const double cn = c * cd - s * sd;
+          s = s * cd + c * sd;
+          c = cn;
+        }
+      }
+
+      // Analysis
+      float re[k_num_harmonics + 1];
+      float im[k_num_harmonics + 1];
+      {
+        float dc = 0.f;
+        for (uint32_t i = 0; i < k_size; ++i)
+          dc += wave[i];
+        re[0] = dc * (1.f / k_size);
+        im[0] = 0.f;
+      }
+      for (uint32_t h = 1; h <= k_num_harmonics; ++h) {
+        float a = 0.f, b = 0.f;
+        for (uint32_t i = 0, j = 0; i < k_size; ++i, j += h) {
+          a += wave[i] * sine[(j + (k_size >> 2)) & k_mask];
+          b += wave[i] * sine[j & k_mask];
+        }
+        const float scale = (h == k_num_harmonics) ? (1.f / k_size) : (2.f / k_size);
+        re[h] = a * scale;
+        im[h] = b * scale;
+      }
+
+      // Synthesis, starting from the darkest level and adding one octave of harmonics per level
+      uint32_t h0 = 1;
+      for (int32_t k = k_num_levels - 1; k >= 0; --k) {
+        float * __restrict l = mLevels[k];
+        const uint32_t h1 = k_num_harmonics >> k;
+        if (k == k_num_levels - 1) {
+          for (uint32_t i = 0; i < k_size; ++i)
+            l[i] = re[0];
+        }
+        else {
+          const float * __restrict prev = mLevels[k + 1];
+          for (uint32_t i = 0; i < k_size; ++i)
+            l[i] = prev[i];
+        }
+        for (uint32_t h = h0; h <= h1; ++h) {
+          const float a = re[h], b = im[h];
+          for (uint32_t i = 0, j = 0; i < k_size; ++i, j += h)
+            l[i] += a * sine[(j + (k_size >> 2)) & k_mask] + b * sine[j & k_mask];
+        }
+        l[k_size] = l[0];
+        h0 = h1 + 1;
+      }
+    }
+
+    /**
+     * Get samples of given level
+     *
+     * @param level Level index, 0 being the brightest
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    const float * level(const uint32_t level) const {
+      return mLevels[level];
+    }
+
+    /*===========================================================================*/
+    /* Static Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Select pair of adjacent levels to crossfade for a given phase increment.
+     *
+     * The brighter level is chosen so that its highest harmonic stays below Nyquist,
+     * crossfading toward the darker one as pitch rises to the next octave.
+     *
+     * @param w0 Phase increment in cycles per sample
+     * @param idx Receives brighter level index
+     * @param xfade Receives crossfade amount toward level idx+1, in [0, 1]
+     *
+     * @note Meant to be called once per block.
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    void selectLevel(const float w0, uint32_t &idx, float &xfade) {
+      const float lf = clipminmaxf(0.f, fasterlog2f(w0 * (2 * k_size)), k_num_levels - 1.f);
+      idx = (uint32_t)lf;
+      if (idx > k_num_levels - 2)
+        idx = k_num_levels - 2;
+      xfade = lf - idx;
+    }
+
+    /**
+     * Read crossfaded pair of levels with linear interpolation
+     *
+     * @param l0 Brighter level
+     * @param l1 Darker level
+     * @param xfade Crossfade amount toward darker level
+     * @param phi Phase in [0, 1)
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float read(const float * l0, const float * l1, const float xfade, const float phi) {
+      const float x0f = phi * k_size;
+      const uint32_t x0 = ((uint32_t)x0f) & k_mask;
+      const float fr = x0f - (uint32_t)x0f;
+      const float y0 = linintf(fr, l0[x0], l0[x0 + 1]);
+      const float y1 = linintf(fr, l1[x0], l1[x0 + 1]);
+      return linintf(xfade, y0, y1);
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float mLevels[k_num_levels][k_level_size];
+  };
+}
+
+/** @} */
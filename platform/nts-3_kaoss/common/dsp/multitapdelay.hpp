@@ -0,0 +1,284 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    multitapdelay.hpp
+ * @brief   Multi-tap reader for delay lines.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "utils/float_math.h"
+#include "utils/buffer_ops.h"
+#include "dsp/delayline.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Reads several weighted taps from a single delay line in one pass.
+   *
+   * Taps are kept sorted by offset so that memory is walked monotonically.
+   *
+   * @tparam MaxTaps Maximum number of taps
+   */
+  template <size_t MaxTaps>
+  struct MultiTapDelay {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /**
+     * Tap with integer offset and pre-multiplied interpolation weights.
+     */
+    typedef struct Tap {
+      uint32_t base; /**< Integer part of offset from write index. */
+      float    g0a;  /**< Weight of sample at base, primary output. */
+      float    g1a;  /**< Weight of sample at base+1, primary output. */
+      float    g0b;  /**< Weight of sample at base, secondary output. */
+      float    g1b;  /**< Weight of sample at base+1, secondary output. */
+    } Tap;
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    MultiTapDelay(void) :
+      mLine(0),
+      mNumTaps(0)
+    { }
+
+    /**
+     * Constructor with delay line to read from.
+     *
+     * @param line Delay line to read taps from
+     */
+    MultiTapDelay(DelayLine *line) :
+      mLine(line),
+      mNumTaps(0)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set the delay line to read taps from.
+     *
+     * @param line Delay line to read taps from
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDelayLine(DelayLine *line) {
+      mLine = line;
+    }
+
+    /**
+     * Set taps with independent gains for each output.
+     *
+     * @param pos Tap offsets from write index as floating point, should be >= 1.
+     * @param gain_a Tap gains for primary output
+     * @param gain_b Tap gains for secondary output
+     * @param count Number of taps, clipped to MaxTaps
+     *
+     * @note Taps are sorted by offset, should not be called from the audio loop.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void setTaps(const float *pos, const float *gain_a, const float *gain_b, size_t count) {
+      if (count > MaxTaps)
+        count = MaxTaps;
+
+      for (size_t i = 0; i < count; ++i) {
+        const uint32_t base = (uint32_t)pos[i];
+        const float frac = pos[i] - base;
+        const Tap t = { base,
+                        gain_a[i] * (1.f - frac), gain_a[i] * frac,
+                        gain_b[i] * (1.f - frac), gain_b[i] * frac };
+
+        // Insertion sort by base offset, tap counts are small
+        size_t j = i;
+        for (; j > 0 && mTaps[j-1].base > base; --j)
+          mTaps[j] = mTaps[j-1];
+        mTaps[j] = t;
+      }
+      mNumTaps = count;
+    }
+
+    /**
+     * Set taps with same gain for both outputs.
+     *
+     * @param pos Tap offsets from write index as floating point, should be >= 1.
+     * @param gain Tap gains
+     * @param count Number of taps, clipped to MaxTaps
+     *
+     * @note Taps are sorted by offset, should not be called from the audio loop.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void setTaps(const float *pos, const float *gain, size_t count) {
+      setTaps(pos, gain, gain, count);
+    }
+
+    /**
+     * Clear all taps.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void clearTaps(void) {
+      mNumTaps = 0;
+    }
+
+    /**
+     * Get number of active taps.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    size_t getNumTaps(void) const {
+      return mNumTaps;
+    }
+
+    /**
+     * Read weighted sum of all taps at current write index.
+     *
+     * @return Sum of taps, using primary gains
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float read(void) {
+      const float * __restrict line = mLine->mLine;
+      const uint32_t mask = mLine->mMask;
+      const uint32_t head = mLine->mWriteIdx;
+      const Tap * __restrict t = mTaps;
+      const Tap * t_e = t + mNumTaps;
+
+      float acc = 0.f;
+      for (; t != t_e; ++t) {
+        const uint32_t idx = head + t->base;
+        acc += t->g0a * line[idx & mask] + t->g1a * line[(idx+1) & mask];
+      }
+      return acc;
+    }
+
+    /**
+     * Read weighted sums of all taps at current write index for both outputs.
+     *
+     * @return Sums of taps, using primary and secondary gains
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    f32pair_t readPair(void) {
+      const float * __restrict line = mLine->mLine;
+      const uint32_t mask = mLine->mMask;
+      const uint32_t head = mLine->mWriteIdx;
+      const Tap * __restrict t = mTaps;
+      const Tap * t_e = t + mNumTaps;
+
+      f32pair_t acc = {0.f, 0.f};
+      for (; t != t_e; ++t) {
+        const uint32_t idx = head + t->base;
+        const float s0 = line[idx & mask];
+        const float s1 = line[(idx+1) & mask];
+        acc.a += t->g0a * s0 + t->g1a * s1;
+        acc.b += t->g0b * s0 + t->g1b * s1;
+      }
+      return acc;
+    }
+
+    /**
+     * Read a block of tap sums, tap by tap.
+     *
+     * @param out Destination for tap sums, overwritten
+     * @param frames Number of frames to read
+     *
+     * @note The whole block of input samples must already have been written to the delay line.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void read(float * __restrict out, const size_t frames) {
+      buf_clr_f32(out, frames);
+
+      const float * __restrict line = mLine->mLine;
+      const uint32_t mask = mLine->mMask;
+      const uint32_t head = mLine->mWriteIdx + frames - 1;
+
+      for (size_t k = 0; k < mNumTaps; ++k) {
+        const Tap t = mTaps[k];
+        uint32_t idx = head + t.base;
+        for (size_t i = 0; i < frames; ++i, --idx)
+          out[i] += t.g0a * line[idx & mask] + t.g1a * line[(idx+1) & mask];
+      }
+    }
+
+    /**
+     * Read a block of tap sums for both outputs, tap by tap.
+     *
+     * @param out Destination for tap sum pairs, overwritten
+     * @param frames Number of frames to read
+     *
+     * @note The whole block of input samples must already have been written to the delay line.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void readPair(f32pair_t * __restrict out, const size_t frames) {
+      buf_clr_f32((float *)out, 2*frames);
+
+      const float * __restrict line = mLine->mLine;
+      const uint32_t mask = mLine->mMask;
+      const uint32_t head = mLine->mWriteIdx + frames - 1;
+
+      for (size_t k = 0; k < mNumTaps; ++k) {
+        const Tap t = mTaps[k];
+        uint32_t idx = head + t.base;
+        for (size_t i = 0; i < frames; ++i, --idx) {
+          const float s0 = line[idx & mask];
+          const float s1 = line[(idx+1) & mask];
+          out[i].a += t.g0a * s0 + t.g1a * s1;
+          out[i].b += t.g0b * s0 + t.g1b * s1;
+        }
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DelayLine *mLine;
+    Tap        mTaps[MaxTaps];
+    size_t     mNumTaps;
+
+  };
+
+}
+
+/** @} */
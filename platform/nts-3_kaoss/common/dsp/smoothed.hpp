@@ -0,0 +1,251 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    smoothed.hpp
+ * @brief   Block-rate parameter smoothing.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Smoothing modes for Smoothed
+   */
+  enum {
+    k_smooth_linear = 0,
+    k_smooth_onepole
+  };
+
+  /**
+   * Parameter smoother producing one increment per block.
+   *
+   * The target is typically set from setParameter() or at the start of a block,
+   * ramp() then returns the value at the start of the block and the per-sample
+   * increment, so that the inner loop only needs value += inc. Once settled the
+   * increment is zero and callers can check isSettled() to skip ramping entirely.
+   *
+   * In linear mode the target is reached after the configured ramp length, rounded
+   * up to a whole block. In one-pole mode the value at the end of each block is the
+   * one the per-sample recursion would reach, and is linearly ramped to within the block.
+   *
+   * @tparam T Floating point value type
+   * @tparam Mode k_smooth_linear or k_smooth_onepole
+   */
+  template <typename T, uint32_t Mode = k_smooth_linear>
+  struct Smoothed {
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     *
+     * @param value Initial value
+     */
+    Smoothed(const T value = T()) :
+      mValue(value),
+      mTarget(value),
+      mRemain(0),
+      mLength(0),
+      mCoef(0.f),
+      mBlockCoef(0.f),
+      mBlockFrames(0),
+      mSettled(true)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set linear ramp length, only used in linear mode
+     *
+     * @param samples Ramp length in samples, 0 to ramp over a single block
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setRampLength(const uint32_t samples) {
+      mLength = samples;
+    }
+
+    /**
+     * Set one-pole coefficient, only used in one-pole mode
+     *
+     * @param coef Per-sample pole in [0, 1), i.e.: exp(-1 / (time constant in samples))
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setCoefficient(const float coef) {
+      mCoef = coef;
+      mBlockFrames = 0;
+    }
+
+    /**
+     * Set new target value
+     *
+     * @note Setting the current target again does not restart a ramp in progress.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTarget(const T target) {
+      if (target == mTarget)
+        return;
+      mTarget = target;
+      mRemain = (mLength > 0) ? mLength : 1;
+      mSettled = false;
+    }
+
+    /**
+     * Jump to value immediately
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setValue(const T value) {
+      mValue = value;
+      mTarget = value;
+      mRemain = 0;
+      mSettled = true;
+    }
+
+    /**
+     * Get value at start of next block
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    T getValue(void) const {
+      return mValue;
+    }
+
+    /**
+     * Get target value
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    T getTarget(void) const {
+      return mTarget;
+    }
+
+    /**
+     * Check whether value has reached target
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    bool isSettled(void) const {
+      return mSettled;
+    }
+
+    /**
+     * Advance by one block
+     *
+     * @param frames Block size in samples
+     * @param inc Receives the per-sample increment for the block
+     *
+     * @return Value at start of block
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    T ramp(const size_t frames, T &inc) {
+      const T start = mValue;
+      if (mSettled || frames == 0) {
+        inc = T();
+        return start;
+      }
+
+      T end;
+      if (Mode == k_smooth_onepole) {
+        if (frames != mBlockFrames)
+          updateBlockCoef(frames);
+        end = mTarget + (start - mTarget) * mBlockCoef;
+        const T d = end - mTarget;
+        if (d < k_epsilon && -d < k_epsilon)
+          end = mTarget;
+      }
+      else {
+        if (mRemain > frames) {
+          end = start + (mTarget - start) * ((float)frames / mRemain);
+          mRemain -= frames;
+        }
+        else {
+          end = mTarget;
+          mRemain = 0;
+        }
+      }
+
+      inc = (end - start) * (1.f / frames);
+      mValue = end;
+      mSettled = (end == mTarget);
+      return start;
+    }
+
+  private:
+
+    /*===========================================================================*/
+    /* Private Methods.                                                          */
+    /*===========================================================================*/
+
+    /**
+     * Raise per-sample coefficient to the block size
+     */
+    inline __attribute__((optimize("Ofast")))
+    void updateBlockCoef(const size_t frames) {
+      float c = 1.f;
+      float p = mCoef;
+      for (size_t n = frames; n; n >>= 1, p *= p)
+        if (n & 1)
+          c *= p;
+      mBlockCoef = c;
+      mBlockFrames = frames;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    static constexpr float k_epsilon = 1e-6f;
+
+    T        mValue;
+    T        mTarget;
+    uint32_t mRemain;
+    uint32_t mLength;
+    float    mCoef;
+    float    mBlockCoef;
+    size_t   mBlockFrames;
+    bool     mSettled;
+  };
+}
+
+/** @} */
@@ -0,0 +1,257 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    stft.hpp
+ * @brief   Short-time Fourier transform with overlap-add resynthesis.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "dsp/fft.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Single channel STFT analysis, spectral processing and overlap-add resynthesis.
+   *
+   * Every hop a windowed frame of the last N input samples is captured. Its forward
+   * transform, the spectral callback, the inverse transform and the overlap-add are
+   * then run as a sequence of passes spread over the following hop, proportionally
+   * to the number of samples processed, so that no single audio block pays for a
+   * whole transform. The frame is complete when the next hop starts.
+   *
+   * Analysis and synthesis both use a sine window (square root of periodic Hann),
+   * with output scaled so that an identity callback reproduces the input.
+   *
+   * Latency is N + N/Overlap samples. Memory use is 5N floats.
+   *
+   * @tparam SizeExp log2 of frame size N, in [6, 12]
+   * @tparam Overlap Number of overlapping frames, hop size being N/Overlap, 2, 4 or 8
+   */
+  template <uint32_t SizeExp, uint32_t Overlap = 4>
+  struct STFT {
+
+    static_assert(Overlap == 2 || Overlap == 4 || Overlap == 8, "Overlap must be 2, 4 or 8");
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    typedef RealFFT<SizeExp> FFT;
+
+    enum {
+      k_size = FFT::k_size,                 /**< Frame size N. */
+      k_hop = FFT::k_size / Overlap,        /**< Hop size. */
+      k_num_bins = FFT::k_size / 2 + 1,     /**< Number of bins in packed spectrum, DC to Nyquist. */
+      k_num_steps = 2 * FFT::k_num_stages + 7, /**< Passes run per hop. */
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    STFT(void) {
+      // sin(pi*i/N) by rotation
+      const double delta = 3.141592653589793 / k_size;
+      const double cd = __builtin_cos(delta);
+      const double sd = __builtin_sin(delta);
+      double c = 1.0, s = 0.0;
+      for (uint32_t i = 0; i < k_size; ++i) {
+        mWindow[i] = (float)s;
+        const double cn = c * cd - s * sd;
+        s = s * cd + c * sd;
+        c = cn;
+      }
+      reset();
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Clear all buffers and restart hop scheduling.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void reset(void) {
+      for (uint32_t i = 0; i < k_size; ++i) {
+        mInput[i] = 0.f;
+        mWork[i] = 0.f;
+      }
+      for (uint32_t i = 0; i < 2 * k_size; ++i)
+        mAccum[i] = 0.f;
+      mInPos = 0;
+      mOutPos = 0;
+      mOlaPos = 0;
+      mHopPos = 0;
+      mStep = k_num_steps;
+    }
+
+    /**
+     * Get latency in samples between input and resynthesized output.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    uint32_t getLatency(void) const {
+      return k_size + k_hop;
+    }
+
+    /**
+     * Process a block of samples.
+     *
+     * @param in Input samples
+     * @param out Output samples, may be the same as in
+     * @param frames Number of samples to process
+     * @param spectral Callable invoked once per hop with the packed spectrum as float *,
+     *                 see RealFFT for layout. May modify the spectrum in place.
+     */
+    template <typename F>
+    inline __attribute__((optimize("Ofast")))
+    void process(const float * in, float * out, size_t frames, F & spectral) {
+      while (frames) {
+        const uint32_t n = (frames < (size_t)(k_hop - mHopPos)) ? (uint32_t)frames : (uint32_t)(k_hop - mHopPos);
+
+        for (uint32_t i = 0; i < n; ++i) {
+          const float x = in[i];
+          out[i] = mAccum[mOutPos];
+          mAccum[mOutPos] = 0.f;
+          mOutPos = (mOutPos + 1) & (2 * k_size - 1);
+          mInput[mInPos] = x;
+          mInPos = (mInPos + 1) & (k_size - 1);
+        }
+        in += n;
+        out += n;
+        frames -= n;
+        mHopPos += n;
+
+        // Catch up on passes of current frame, proportionally to hop progress
+        const uint32_t target = (mHopPos * k_num_steps) / k_hop;
+        while (mStep < target)
+          runStep(mStep++, spectral);
+
+        if (mHopPos == k_hop) {
+          mHopPos = 0;
+          capture();
+        }
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    FFT      mFFT;
+    float    mWindow[k_size];
+    float    mInput[k_size];
+    float    mWork[k_size];
+    float    mAccum[2 * k_size];
+    uint32_t mInPos;
+    uint32_t mOutPos;
+    uint32_t mOlaPos;
+    uint32_t mHopPos;
+    uint32_t mStep;
+
+  private:
+
+    /**
+     * Copy windowed frame of last N input samples and schedule its passes.
+     *
+     * Output of the frame starts one hop from now. The accumulator holds 2N samples
+     * so that overlap-add never touches samples being output during the hop.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void capture(void) {
+      for (uint32_t i = 0; i < k_size; ++i)
+        mWork[i] = mWindow[i] * mInput[(mInPos + i) & (k_size - 1)];
+      mOlaPos = (mOutPos + k_hop) & (2 * k_size - 1);
+      mStep = 0;
+    }
+
+    /**
+     * Run a single pass of the current frame.
+     */
+    template <typename F>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void runStep(const uint32_t step, F & spectral) {
+      const uint32_t stages = FFT::k_num_stages;
+      if (step == 0)
+        mFFT.bitReverse(mWork);
+      else if (step <= stages)
+        mFFT.stage(mWork, step - 1);
+      else if (step == stages + 1)
+        mFFT.forwardPost(mWork);
+      else if (step == stages + 2)
+        spectral(mWork);
+      else if (step == stages + 3)
+        mFFT.inversePre(mWork);
+      else if (step == stages + 4)
+        mFFT.bitReverse(mWork);
+      else if (step <= 2 * stages + 4)
+        mFFT.stage(mWork, step - stages - 5);
+      else if (step == 2 * stages + 5)
+        mFFT.inversePost(mWork);
+      else
+        overlapAdd();
+    }
+
+    /**
+     * Apply synthesis window and add frame to accumulator.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void overlapAdd(void) {
+      // Sum of squared sine windows at hop N/Overlap is Overlap/2
+      const float g = 2.f / Overlap;
+      uint32_t pos = mOlaPos;
+      for (uint32_t i = 0; i < k_size; ++i) {
+        mAccum[pos] += g * mWindow[i] * mWork[i];
+        pos = (pos + 1) & (2 * k_size - 1);
+      }
+    }
+
+  };
+
+}
+
+/** @} */
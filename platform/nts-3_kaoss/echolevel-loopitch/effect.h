@@ -52,6 +52,9 @@
 
 #include "utils/buffer_ops.h" // for buf_clr_f32()
 #include "utils/int_math.h"   // for clipminmaxi32()
+#include "utils/fixed_math.h" // for q15_t, f32_to_q15()
+
+#include "dsp/oversampler.hpp" // for HalfBandDecimator
 
 // === Defines ===
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -61,35 +64,115 @@
 // WARNING - never use fewer than 2 grains (div zero risk)
 #define MAX_GRAINS 24
 
-// === Globals (static) ===
-static uint32_t bufferWritePos = 0;
-static float bufferReadPos = 0.0f;
-static uint32_t bufferLength = 0;
-
-static int isRecording = 0;
-static int isPlaying = 0;
-static bool shouldRandomise = false;
-static bool touchEngaged = false;
-static bool grainModeEnabled = true;
-static int voices = 2; // never let this go below 2!
-static float grainMixGain = 1.0f / sqrtf((float)voices); // recalc when voice count changes
-
-uint32_t rng_state = 123456789; // Seed — can be anything
-
-uint32_t fast_rand_u32() {
-  rng_state = rng_state * 1664525 + 1013904223; // LCG constants
-  return rng_state;
-}
-
-uint32_t fast_rand_u32_range(uint32_t min, uint32_t max) {
-  uint32_t r = fast_rand_u32();
-  uint32_t range = max - min + 1;
-  return min + (r % range);
-}
+// Grain pool size, leaves headroom for jittered grain starts at maximum density
+#define GRAIN_POOL 32
+
+// Grain starts allowed per render chunk, later ones are deferred to the next chunk
+#define MAX_SPAWNS_PER_CHUNK 4
+
+// Grain envelope table size, must be a power of two
+#define GRAIN_ENV_SIZE 256
+#define GRAIN_ENV_SHIFT 24 // 32 - log2(GRAIN_ENV_SIZE)
+#define GRAIN_RELEASE_FRAMES 240 // forced fade-out, 5ms at 48kHz
+
+// Loop copies at full, half and quarter rate, used for pitching up without aliasing
+#define MIP_LEVELS 3
+
+// Frames of loop tail/head run through the decimators when recording stops, to make mip levels loop seamlessly
+#define MIP_SEAM_FRAMES 192
+
+// Loop slots, selected by touch bands in the upper half of the pad
+#define MAX_SLOTS 4
+#define MIN_SLOT_FRAMES 192000 // 4s, fewer slots are used rather than making them shorter
+#define SDRAM_BUDGET 0x300000  // genericfx SDRAM per runtime, assumed when the runtime cannot report it
+#define SDRAM_RESERVE 1024    // bytes left for allocator overhead when splitting SDRAM between slots
+
+// Crossfade written into the head of the loop when recording stops, 10ms, must be a multiple of 4
+#define LOOP_SEAM_FRAMES 480
+
+// Tempo divisions grains can be synced to, in 4ppqn ticks (16th notes)
+#define SYNC_DIVISIONS 8
+#define SYNC_BAR_TICKS 16.0f // tick phase wraps once per 4/4 bar, a multiple of every division
+
+// 128th note to one bar
+static const float syncDivTicks[SYNC_DIVISIONS] = { 0.125f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f };
+
+// === Grain envelopes (const, kept in flash) ===
+// One guard point at the end for interpolation
+
+// Hann window, 0.5 * (1 - cos(2 * pi * i / 256))
+static const float grainEnvHann[GRAIN_ENV_SIZE + 1] = {
+  0.00000000f, 0.00015059f, 0.00060227f, 0.00135477f, 0.00240764f, 0.00376023f, 0.00541175f, 0.00736118f,
+  0.00960736f, 0.01214893f, 0.01498437f, 0.01811197f, 0.02152983f, 0.02523591f, 0.02922797f, 0.03350360f,
+  0.03806023f, 0.04289512f, 0.04800535f, 0.05338785f, 0.05903937f, 0.06495650f, 0.07113569f, 0.07757322f,
+  0.08426519f, 0.09120759f, 0.09839623f, 0.10582679f, 0.11349477f, 0.12139558f, 0.12952444f, 0.13787646f,
+  0.14644661f, 0.15522973f, 0.16422052f, 0.17341358f, 0.18280336f, 0.19238420f, 0.20215035f, 0.21209590f,
+  0.22221488f, 0.23250119f, 0.24294863f, 0.25355090f, 0.26430163f, 0.27519434f, 0.28622245f, 0.29737934f,
+  0.30865828f, 0.32005248f, 0.33155507f, 0.34315913f, 0.35485766f, 0.36664362f, 0.37850991f, 0.39044938f,
+  0.40245484f, 0.41451906f, 0.42663476f, 0.43879466f, 0.45099143f, 0.46321772f, 0.47546616f, 0.48772939f,
+  0.50000000f, 0.51227061f, 0.52453384f, 0.53678228f, 0.54900857f, 0.56120534f, 0.57336524f, 0.58548094f,
+  0.59754516f, 0.60955062f, 0.62149009f, 0.63335638f, 0.64514234f, 0.65684087f, 0.66844493f, 0.67994752f,
+  0.69134172f, 0.70262066f, 0.71377755f, 0.72480566f, 0.73569837f, 0.74644910f, 0.75705137f, 0.76749881f,
+  0.77778512f, 0.78790410f, 0.79784965f, 0.80761580f, 0.81719664f, 0.82658642f, 0.83577948f, 0.84477027f,
+  0.85355339f, 0.86212354f, 0.87047556f, 0.87860442f, 0.88650523f, 0.89417321f, 0.90160377f, 0.90879241f,
+  0.91573481f, 0.92242678f, 0.92886431f, 0.93504350f, 0.94096063f, 0.94661215f, 0.95199465f, 0.95710488f,
+  0.96193977f, 0.96649640f, 0.97077203f, 0.97476409f, 0.97847017f, 0.98188803f, 0.98501563f, 0.98785107f,
+  0.99039264f, 0.99263882f, 0.99458825f, 0.99623977f, 0.99759236f, 0.99864523f, 0.99939773f, 0.99984941f,
+  1.00000000f, 0.99984941f, 0.99939773f, 0.99864523f, 0.99759236f, 0.99623977f, 0.99458825f, 0.99263882f,
+  0.99039264f, 0.98785107f, 0.98501563f, 0.98188803f, 0.97847017f, 0.97476409f, 0.97077203f, 0.96649640f,
+  0.96193977f, 0.95710488f, 0.95199465f, 0.94661215f, 0.94096063f, 0.93504350f, 0.92886431f, 0.92242678f,
+  0.91573481f, 0.90879241f, 0.90160377f, 0.89417321f, 0.88650523f, 0.87860442f, 0.87047556f, 0.86212354f,
+  0.85355339f, 0.84477027f, 0.83577948f, 0.82658642f, 0.81719664f, 0.80761580f, 0.79784965f, 0.78790410f,
+  0.77778512f, 0.76749881f, 0.75705137f, 0.74644910f, 0.73569837f, 0.72480566f, 0.71377755f, 0.70262066f,
+  0.69134172f, 0.67994752f, 0.66844493f, 0.65684087f, 0.64514234f, 0.63335638f, 0.62149009f, 0.60955062f,
+  0.59754516f, 0.58548094f, 0.57336524f, 0.56120534f, 0.54900857f, 0.53678228f, 0.52453384f, 0.51227061f,
+  0.50000000f, 0.48772939f, 0.47546616f, 0.46321772f, 0.45099143f, 0.43879466f, 0.42663476f, 0.41451906f,
+  0.40245484f, 0.39044938f, 0.37850991f, 0.36664362f, 0.35485766f, 0.34315913f, 0.33155507f, 0.32005248f,
+  0.30865828f, 0.29737934f, 0.28622245f, 0.27519434f, 0.26430163f, 0.25355090f, 0.24294863f, 0.23250119f,
+  0.22221488f, 0.21209590f, 0.20215035f, 0.19238420f, 0.18280336f, 0.17341358f, 0.16422052f, 0.15522973f,
+  0.14644661f, 0.13787646f, 0.12952444f, 0.12139558f, 0.11349477f, 0.10582679f, 0.09839623f, 0.09120759f,
+  0.08426519f, 0.07757322f, 0.07113569f, 0.06495650f, 0.05903937f, 0.05338785f, 0.04800535f, 0.04289512f,
+  0.03806023f, 0.03350360f, 0.02922797f, 0.02523591f, 0.02152983f, 0.01811197f, 0.01498437f, 0.01214893f,
+  0.00960736f, 0.00736118f, 0.00541175f, 0.00376023f, 0.00240764f, 0.00135477f, 0.00060227f, 0.00015059f,
+  0.00000000f
+};
 
-float fast_randf(float min_val, float max_val) {
-  return min_val + (fast_rand_u32() / 4294967296.0f) * (max_val - min_val);
-}
+// Tukey window with alpha = 0.5, i.e. Hann shaped ramps over the first and last quarter
+static const float grainEnvTukey[GRAIN_ENV_SIZE + 1] = {
+  0.00000000f, 0.00060227f, 0.00240764f, 0.00541175f, 0.00960736f, 0.01498437f, 0.02152983f, 0.02922797f,
+  0.03806023f, 0.04800535f, 0.05903937f, 0.07113569f, 0.08426519f, 0.09839623f, 0.11349477f, 0.12952444f,
+  0.14644661f, 0.16422052f, 0.18280336f, 0.20215035f, 0.22221488f, 0.24294863f, 0.26430163f, 0.28622245f,
+  0.30865828f, 0.33155507f, 0.35485766f, 0.37850991f, 0.40245484f, 0.42663476f, 0.45099143f, 0.47546616f,
+  0.50000000f, 0.52453384f, 0.54900857f, 0.57336524f, 0.59754516f, 0.62149009f, 0.64514234f, 0.66844493f,
+  0.69134172f, 0.71377755f, 0.73569837f, 0.75705137f, 0.77778512f, 0.79784965f, 0.81719664f, 0.83577948f,
+  0.85355339f, 0.87047556f, 0.88650523f, 0.90160377f, 0.91573481f, 0.92886431f, 0.94096063f, 0.95199465f,
+  0.96193977f, 0.97077203f, 0.97847017f, 0.98501563f, 0.99039264f, 0.99458825f, 0.99759236f, 0.99939773f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f, 1.00000000f,
+  1.00000000f, 0.99939773f, 0.99759236f, 0.99458825f, 0.99039264f, 0.98501563f, 0.97847017f, 0.97077203f,
+  0.96193977f, 0.95199465f, 0.94096063f, 0.92886431f, 0.91573481f, 0.90160377f, 0.88650523f, 0.87047556f,
+  0.85355339f, 0.83577948f, 0.81719664f, 0.79784965f, 0.77778512f, 0.75705137f, 0.73569837f, 0.71377755f,
+  0.69134172f, 0.66844493f, 0.64514234f, 0.62149009f, 0.59754516f, 0.57336524f, 0.54900857f, 0.52453384f,
+  0.50000000f, 0.47546616f, 0.45099143f, 0.42663476f, 0.40245484f, 0.37850991f, 0.35485766f, 0.33155507f,
+  0.30865828f, 0.28622245f, 0.26430163f, 0.24294863f, 0.22221488f, 0.20215035f, 0.18280336f, 0.16422052f,
+  0.14644661f, 0.12952444f, 0.11349477f, 0.09839623f, 0.08426519f, 0.07113569f, 0.05903937f, 0.04800535f,
+  0.03806023f, 0.02922797f, 0.02152983f, 0.01498437f, 0.00960736f, 0.00541175f, 0.00240764f, 0.00060227f,
+  0.00000000f
+};
 
 class Effect {
  public:
@@ -99,9 +182,22 @@ class Effect {
 
 
   enum {
-    BUFFER_LENGTH = 0x80000 
+    BUFFER_LENGTH = 0x80000 // maximum slot capacity in stereo frames, ~10.9s at 48kHz
   };
 
+  enum {
+    RENDER_CHUNK = 64 // frames rendered per pass into the block accumulator
+  };
+
+  enum : uint32_t {
+    DEFAULT_SEED = 123456789 // can be anything
+  };
+
+  typedef dsp::HalfBandDecimator<12> MipDecimator;
+
+  // Loop audio is stored as Q15, twice the recording time of float in the same SDRAM
+  typedef q15_t loop_sample_t;
+
   enum {
     PARAM1 = 0U,
     PARAM2,
@@ -109,6 +205,8 @@ class Effect {
     PITCHMODE, 
     PLAYMODE, 
     DRIFT,
+    SIZE,
+    FEEDBACK,
     NUM_PARAMS
   };
 
@@ -120,6 +218,8 @@ class Effect {
     uint32_t param4{1};
     uint32_t param5{1};
     float param6{0.f};
+    uint32_t size{100}; // grain size in ms
+    uint32_t feedback{0}; // percent of the loop kept when overdubbing, 0 records a new loop
 
     void reset() 
     {
@@ -129,6 +229,8 @@ class Effect {
       param4 = 0;
       param5 = 0;
       param6 = 0.f;
+      size = 100;
+      feedback = 0;
     }
   };
 
@@ -145,16 +247,85 @@ class Effect {
   enum {
     PARAM5_VALUE0 = 0, // auto play
     PARAM5_VALUE1, // touch play
+    PARAM5_VALUE2, // auto play, tempo synced
+    PARAM5_VALUE3, // touch play, tempo synced
     NUM_PARAM5_VALUES,
   };
   
+  // Grain state as structure of arrays, so that each grain can be rendered over
+  // the whole block with its state kept in registers. Active grains are packed
+  // at the start of the arrays.
+  typedef struct {
+    float readPos[GRAIN_POOL];
+    float speed[GRAIN_POOL];
+    uint32_t envPhase[GRAIN_POOL]; // Q32 position within grain envelope
+    uint32_t envInc[GRAIN_POOL];
+    float gainL[GRAIN_POOL]; // pan gains, including mono sum and voice mix gain
+    float gainR[GRAIN_POOL];
+    uint32_t startFrame[GRAIN_POOL]; // first frame to render for grains started in current chunk
+    const float * env[GRAIN_POOL];
+    const loop_sample_t * buffer[GRAIN_POOL]; // mip level picked for the grain's speed, positions are in that level's frames
+    uint32_t length[GRAIN_POOL];
+  } GrainBank;
+
+  // Loop slot, interleaved stereo full rate buffer plus half and quarter rate copies if enabled
   typedef struct {
-    float readPos;
-    float speed;
-    float loopLength;
-    float startOffset;
-    float pan; // -1.0 (left) to 1.0 (right)
-  } Grain;
+    loop_sample_t * level[MIP_LEVELS];
+    uint32_t length; // recorded frames, 0 while empty or being recorded
+    uint32_t capacity; // frames that can be recorded, a multiple of 4
+  } LoopSlot;
+
+  // Control events, posted by setParameter()/touchEvent() and applied at the start of Process()
+  enum {
+    EVENT_TOUCH = 0U,
+    EVENT_PARAM,
+  };
+
+  typedef struct {
+    uint8_t type;
+    uint8_t id; // touch phase or parameter index
+    int32_t x;  // touch x or parameter value
+    int32_t y;  // touch y
+  } ControlEvent;
+
+  enum {
+    EVENT_QUEUE_SIZE = 64 // must be a power of two
+  };
+
+  // Lock-free ring with a single producer, the control thread, and a single consumer, Process().
+  // Indices run freely and are masked on access, so that full and empty can be told apart.
+  struct EventQueue {
+    ControlEvent events[EVENT_QUEUE_SIZE];
+    std::atomic_uint_fast32_t head{0}; // next slot to write, only advanced by the producer
+    std::atomic_uint_fast32_t tail{0}; // next slot to read, only advanced by the consumer
+
+    inline bool push(const ControlEvent & e)
+    {
+      const uint32_t h = (uint32_t)head.load(std::memory_order_relaxed);
+      if ((uint32_t)(h - (uint32_t)tail.load(std::memory_order_acquire)) >= EVENT_QUEUE_SIZE)
+        return false;
+      events[h & (EVENT_QUEUE_SIZE - 1)] = e;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    inline bool pop(ControlEvent & e)
+    {
+      const uint32_t t = (uint32_t)tail.load(std::memory_order_relaxed);
+      if (t == (uint32_t)head.load(std::memory_order_acquire))
+        return false;
+      e = events[t & (EVENT_QUEUE_SIZE - 1)];
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+  };
+
+  // flags_ bits, set for events that did not fit in the queue. Bits below NUM_PARAMS
+  // mark parameters to be reapplied from paramValues_.
+  enum {
+    k_flags_none = 0U,
+    k_flag_touch = 1U << NUM_PARAMS, // reapply touchLatest_
+  };
 
   /*===========================================================================*/
   /* Lifecycle Methods. */
@@ -186,20 +357,34 @@ class Effect {
     // If SDRAM buffers are required they must be allocated here
     if (!desc->hooks.sdram_alloc)
       return k_unit_err_memory;
-    float *m = (float *)desc->hooks.sdram_alloc(BUFFER_LENGTH*sizeof(float));
-    if (!m)
+    const size_t avail = desc->hooks.sdram_avail ? desc->hooks.sdram_avail() : (size_t)SDRAM_BUDGET;
+    if (!allocateSlots(desc, avail))
       return k_unit_err_memory;
 
-    // Make sure memory is cleared
-    buf_clr_f32(m, BUFFER_LENGTH);
-    
-    allocated_buffer_ = m;
-
     // Cache the runtime descriptor for later use
     runtime_desc_ = *desc;
 
     // Make sure parameters are reset to default values
     params_.reset();
+    rngState = DEFAULT_SEED;
+    for (uint8_t i = 0; i < NUM_PARAMS; ++i)
+      paramValues_[i].store(stateParameterValue(i), std::memory_order_relaxed);
+
+    // Nothing is pending before the first block
+    events_.head.store(0);
+    events_.tail.store(0);
+    flags_.store(k_flags_none);
+    touchLatest_.store(0);
+
+    tempo_.store(0);
+    tickCounter_.store(0);
+    tickReceived_.store(false);
+    tempoSeen_ = 0;
+    framesPerTick_ = 0.0f;
+    tickPhase_ = 0.0f;
+    syncFiredAgo_ = SYNC_BAR_TICKS;
+
+    updateGrainPanning();
     
     return k_unit_err_none;
   }
@@ -207,7 +392,10 @@ class Effect {
   inline void Teardown() {
     // Note: buffers allocated via sdram_alloc are automatically freed after unit teardown
     // Note: cleanup and release resources if any
-    allocated_buffer_ = nullptr;
+    for (int i = 0; i < MAX_SLOTS; ++i)
+      for (int level = 0; level < MIP_LEVELS; ++level)
+        slots_[i].level[level] = nullptr;
+    numSlots_ = 0;
   }
 
   inline void Reset() {
@@ -231,11 +419,20 @@ class Effect {
   /* Other Public Methods. */
   /*===========================================================================*/
 
+  // Seeds this instance's grain randomisation, e.g. for repeatable offline renders.
+  // Init() restores the default seed.
+  inline void setRandomSeed(uint32_t seed) {
+    rngState = seed;
+  }
+
   fast_inline void Process(const float * in, float * out, size_t frames) {
     const float * __restrict in_p = in;
     float * __restrict out_p = out;
     const float * out_e = out_p + (frames << 1);  // assuming stereo output
 
+    // Touches and parameter changes take effect here, in the order they happened
+    drainEvents();
+
     // Get pitch mode
     int semitone_range = 0; // free hz repitching
     switch (params_.param4) 
@@ -249,13 +446,15 @@ class Effect {
     switch (params_.param5)
     {
       // Only override this if play mode is auto
-      case 0: touchEngaged = true; break;
+      case PARAM5_VALUE0: 
+      case PARAM5_VALUE2: touchEngaged = true; break;
     }
 
+    // Sync modes fall back to free running until a tempo is known
+    updateTempo();
+    const bool synced = (params_.param5 >= PARAM5_VALUE2) && (framesPerTick_ > 0.0f);
+
     const float drift = params_.param6 / 10000.0f;
-    
-    voices = CLAMP((int)(params_.depth * MAX_GRAINS), 2, MAX_GRAINS);
-    grainMixGain = 1.0f / sqrtf((float)voices);
 
     // Get mode and playback speed from params
     const float x = params_.param1; // X-axis
@@ -283,285 +482,179 @@ class Effect {
     const bool shouldRecord = (y > 0.5f);
     const bool shouldPlay = !shouldRecord;
 
-    if (shouldRecord && !isRecording) 
+    // Pan gains only need updating when the voice count changes
+    const int voicecount = CLAMP((int)(params_.depth * MAX_GRAINS), 2, MAX_GRAINS);
+    if (voicecount != voices)
     {
-      bufferWritePos = 0;
-      bufferLength = 0;
-      isRecording = 1;
-      isPlaying = 0;
+      voices = voicecount;
+      grainMixGain = 1.0f / sqrtf((float)voices);
+      updateGrainPanning();
+      nextVoice = 0;
+    }
 
+    if (shouldRecord && !isRecording) 
+    {
+      // Other slots keep playing while one is recorded
+      recSlot_ = MIN(selectedSlot_, numSlots_ - 1);
+      if (params_.feedback > 0 && slots_[recSlot_].length >= 4)
+      {
+        startOverdub();
+      }
+      else
+      {
+        isOverdubbing = false;
+        bufferWritePos = 0;
+        bufferLength = 0;
+        slots_[recSlot_].length = 0;
+        dropGrains(recSlot_);
+        if (playSlot_ == recSlot_)
+          isPlaying = false;
+        resetMips(slots_[recSlot_].capacity);
+      }
+      isRecording = true;
     } 
-    else if (shouldPlay && !isPlaying) 
+    else if (shouldPlay && isRecording)
     {
-      bufferReadPos = 0.0f;
-      isPlaying = 1;
-      isRecording = 0;      
- 
-      // init grains
-      int voicecount = CLAMP(voices, 2, MAX_GRAINS);
-      for(int i = 0; i < voicecount; i++)
+      if (isOverdubbing)
       {
-        grains[i].startOffset = 0.f;
-        grains[i].loopLength = bufferLength;
-        grains[i].readPos = grains[i].startOffset;
-        grains[i].speed = playbackSpeed;
-        //grains[i].pan = fast_randf(-1.0f, 1.0f);        
+        flushMips();
       }
-      updateGrainPanning();
+      else
+      {
+        finishLoop(synced);
+        finishMips();
+      }
+      slots_[recSlot_].length = bufferLength;
+      isRecording = false;
+
+      // Newly recorded slot takes over playback, an overdubbed one just carries on
+      const bool continuing = isOverdubbing && isPlaying && playSlot_ == recSlot_;
+      isOverdubbing = false;
+      playSlot_ = recSlot_;
+      if (!continuing)
+        startPlayback();
     }
-    
-
-    for (; out_p != out_e; in_p += 2, out_p += 2) 
+    else if (shouldPlay && !isPlaying) 
     {
-      // Process samples here      
+      startPlayback();
+    }
 
-      float outL = in_p[0];
-      float outR = in_p[1];
+    const bool render = isPlaying && slots_[playSlot_].length > 1;
 
-      if (isRecording) {
-        allocated_buffer_[bufferWritePos * 2 ] = outL;
-        allocated_buffer_[bufferWritePos * 2 + 1] = outR;
-        bufferWritePos = (bufferWritePos + 1) % BUFFER_LENGTH;
-        bufferLength = MIN((float)(bufferLength + 1), (float)BUFFER_LENGTH);
-      }
-      
-      if (touchEngaged && isPlaying && bufferLength > 1) {
-        
-        if (grainModeEnabled) 
-        {
-          
-          int voicecount = CLAMP(voices, 2, MAX_GRAINS);
-          for (int i = 0; i < voicecount; ++i) 
-          {
-              Grain* g = &grains[i];
-       
-              float readPos = g->readPos;
-              int indexA = CLAMP((int)floorf(readPos), 0, bufferLength - 2);
-              int indexB = indexA + 1; // guaranteed safe since indexA <= bufferLength - 2
-       
-              // Sample interpolation for both channels
-              float sA_L = allocated_buffer_[indexA * 2];
-              float sA_R = allocated_buffer_[indexA * 2 + 1];
-              float sB_L = allocated_buffer_[indexB * 2];
-              float sB_R = allocated_buffer_[indexB * 2 + 1];
-       
-              float frac = readPos - (float)indexA;
-              float interpL = sA_L + frac * (sB_L - sA_L);
-              float interpR = sA_R + frac * (sB_R - sA_R);
-       
-              // Mix the left and right channels to mono (sum them)
-              float grainMono = (interpL + interpR) * 0.5f; // Mono grain mix
-       
-              // Pan control: Apply panning after mixing to mono
-              float pan = g->pan * 0.5f + 0.5f; // Normalize pan
-              float gainL = cosf(pan * M_PI_2);  // Left channel gain
-              float gainR = sinf(pan * M_PI_2);  // Right channel gain
-       
-              // Apply panning to the mono grain mix
-              outL += grainMono * gainL * grainMixGain;
-              outR += grainMono * gainR * grainMixGain;
-       
-              // Update read position and apply wrapping logic
-              g->readPos = MIN(MAX(g->readPos, 0.0f), (float)(bufferLength - 1));
-       
-              bool wrapped = false;
-       
-              g->readPos += g->speed;
-              if (g->readPos >= g->startOffset + g->loopLength) 
-              {
-                  g->readPos -= g->loopLength;
-                  wrapped = true;
-              } else if (g->readPos < g->startOffset) 
-              {
-                  g->readPos += g->loopLength;
-                  wrapped = true;
-              }
-       
-              // Randomise read positions and loop length on wrap
-              if (wrapped && bufferLength > 1) 
-              {
-                  g->loopLength = fast_rand_u32_range(24.0f, bufferLength);
-                  if (g->loopLength < 16.f) 
-                      g->loopLength = 16.f;
-
-                  g->readPos = fast_randf(0.0f, g->loopLength - 4.f);
-
-                  // Reset to base speed
-                  float baseSpeed = playbackSpeed;
-
-                  if(shouldRandomise)
-                  {
-                    // Randomly apply octave shift
-                    float octaveChance = fast_randf(0.0f, 1.0f);
-                    if (octaveChance < 0.25f) {
-                        baseSpeed *= 0.5f; // octave down
-                    } else if (octaveChance > 0.75f) {
-                        baseSpeed *= 2.0f; // octave up
-                    }
-                  }
-                  
-
-                  g->speed = baseSpeed += fast_randf(0.0f - drift, drift);
-              }       
-              
-          }
-        }
-        else
-        {
-          // Simple stereo playback of recorded input at desired playback rate
+    // Grain spray from the lower half of the pad's Y axis, none at its top edge up to the whole loop at the bottom
+    const float spray = CLAMP((0.5f - y) * 2.0f, 0.0f, 1.0f);
 
-          int indexAL = (int)floorf(bufferReadPos);
-          int indexBL = (indexAL + 1) % bufferLength;
+    float acc[RENDER_CHUNK * 2];
 
-          int indexAR = (int)floorf(bufferReadPos);
-          int indexBR = (indexAR + 1) % bufferLength;
-      
-          // If the buffer length is zero, reset read position to a safe state
-          if (bufferLength == 0) 
-          {
-            bufferReadPos = 0.0f;
-          }
-
-          float sAL = allocated_buffer_[indexAL * 2];
-          float sAR = allocated_buffer_[indexAR * 2 + 1];
-          float sBL = allocated_buffer_[indexBL * 2];
-          float sBR = allocated_buffer_[indexBR * 2 + 1];
-      
-          float fracL = bufferReadPos - (float)indexAL;
-          float fracR = bufferReadPos - (float)indexAR;
-          float interpL = fracL * (sBL - sAL);
-          float interpR = fracR * (sBR - sAR);
-          // Mixes live input with sample playback - defeat with 'MUTE' button on hardware
-          outL = (outL + sAL + interpL);
-          outR = (outR + sAR + interpR);
-      
-          // Ensure bufferLength is always valid (clamp it)
-          bufferLength = MIN((float)bufferLength, (float)BUFFER_LENGTH);
+    while (out_p != out_e) 
+    {
+      const size_t n = MIN((size_t)(out_e - out_p) >> 1, (size_t)RENDER_CHUNK);
 
-          bool wrapped = false;
+      buf_clr_f32(acc, n * 2);
 
-          bufferReadPos += playbackSpeed;
+      if (grainModeEnabled)
+      {
+        // Grains already started play out their envelope when touch is released
+        if (render && touchEngaged)
+          scheduleGrains(n, playbackSpeed, drift, spray, synced);
+        renderGrains(acc, n);
+      }
+      else if (render && touchEngaged)
+      {
+        renderNormal(acc, n, playbackSpeed, mipLevel(playbackSpeed));
+      }
 
-          if(bufferReadPos >= bufferLength)
-          {
-            bufferReadPos -= bufferLength;
-            wrapped = true;
-          }
-          else if (bufferReadPos < 0.0f)
-          {
-            bufferReadPos += bufferLength;
-            wrapped = true;
-          }
+      // Recorded after rendering, so that playback of an overdubbed loop only holds the
+      // previous layers and the live input is not heard twice
+      if (isRecording)
+        recordBlock(in_p, n);
 
-        } // if grainenabled ends
-          
+      // Mixes live input with sample playback - defeat with 'MUTE' button on hardware
+      for (size_t i = 0; i < n * 2; i += 2, in_p += 2, out_p += 2) 
+      {
+        out_p[0] = CLAMP(in_p[0] + acc[i], -1.0f, 1.0f);
+        out_p[1] = CLAMP(in_p[1] + acc[i + 1], -1.0f, 1.0f);
       }
 
-      out_p[0] = CLAMP(outL, -1.0f, 1.0f);
-      out_p[1] = CLAMP(outR, -1.0f, 1.0f);      
-      
-    } // main sample processing loop ends
-    
-
+      advanceTickPhase(n);
+    } // main block processing loop ends
   }
 
+  // Pan gains for each voice, handed out in turn to new grains
   inline void updateGrainPanning()
   {
     int voicecount = CLAMP(voices, 2, MAX_GRAINS);
     for(int i = 0; i < voicecount; i++)
     {
+      float pan;
       if (voicecount == 2) 
         {
-          grains[i].pan = (i == 0) ? -1.0f : 1.0f;  // hard left/right
+          pan = (i == 0) ? -1.0f : 1.0f;  // hard left/right
         } else 
         {
-          grains[i].pan = -1.0f + 2.0f * (float)i / (voicecount - 1); // evenly spread
-          //grains[i].pan = fast_randf(-1.0f, 1.0f);  // Random scatter
+          pan = -1.0f + 2.0f * (float)i / (voicecount - 1); // evenly spread
+          //pan = fast_randf(-1.0f, 1.0f);  // Random scatter
         }
+
+      // Constant power pan law, 0.5 from averaging channels to mono is folded in
+      pan = pan * 0.5f + 0.5f; // Normalize pan
+      voicePanL_[i] = cosf(pan * M_PI_2) * 0.5f * grainMixGain;
+      voicePanR_[i] = sinf(pan * M_PI_2) * 0.5f * grainMixGain;
     }
   }
 
   inline void setParameter(uint8_t index, int32_t value) {
     switch (index) {
     case PARAM1:
-      // 10bit 0-1023 parameter
-      value = clipminmaxi32(0, value, 1023);
-      params_.param1 = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
-      break;
-
     case PARAM2:
       // 10bit 0-1023 parameter
       value = clipminmaxi32(0, value, 1023);
-      params_.param2 = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
       break;
 
     case DEPTH:
-      // Single digit base-10 fractional value, bipolar dry/wet
       value = clipminmaxi32(0, value, 1000);
-      params_.depth = param_10bit_to_f32(value); // 0 .. 1000 -> 0.0 .. 1.0
-      updateGrainPanning();
       break;
 
     case PITCHMODE:
       // strings type parameter, receiving index value
       value = clipminmaxi32(PARAM4_VALUE0, value, NUM_PARAM4_VALUES-1);
-      params_.param4 = value;
       break;
 
     case PLAYMODE:
       // strings type parameter, receiving index value
       value = clipminmaxi32(PARAM5_VALUE0, value, NUM_PARAM5_VALUES-1);
-      params_.param5 = value;
       break;
 
     case DRIFT:
       // Single digit base-10 0-99
       value = clipminmaxi32(0, value, 99);
-      params_.param6 = value;
-      break;
-      
-    default:
-      break;
-    }
-  }
-
-  inline int32_t getParameterValue(uint8_t index) const {
-    switch (index) {
-    case PARAM1:
-      // 10bit 0-1023 parameter
-      return param_f32_to_10bit(params_.param1);
-      break;
-
-    case PARAM2:
-      // 10bit 0-1023 parameter
-      return param_f32_to_10bit(params_.param2);
-      break;
-
-    case DEPTH:
-      // Single digit base-10 fractional value, bipolar dry/wet
-      return param_f32_to_10bit(params_.depth);
       break;
 
-    case PITCHMODE:
-      // strings type parameter, return index value
-      return params_.param4;
+    case SIZE:
+      // Grain size, 10-500 ms
+      value = clipminmaxi32(10, value, 500);
       break;
 
-    case PLAYMODE:
-      // strings type parameter, return index value
-      return params_.param5;
-      break;
-
-    case DRIFT:
-      // strings type parameter, return index value
-      return params_.param6;
+    case FEEDBACK:
+      value = clipminmaxi32(0, value, 100);
       break;
       
     default:
-      break;
+      return;
     }
 
-    return INT_MIN; // Note: will be handled as invalid
+    // Latest value is kept for getParameterValue() and in case the queue is full
+    paramValues_[index].store(value, std::memory_order_relaxed);
+
+    const ControlEvent e = { EVENT_PARAM, index, value, 0 };
+    if (!events_.push(e))
+      flags_.fetch_or(1U << index);
+  }
+
+  inline int32_t getParameterValue(uint8_t index) const {
+    if (index >= NUM_PARAMS)
+      return INT_MIN; // Note: will be handled as invalid
+    return paramValues_[index].load(std::memory_order_relaxed);
   }
 
   inline const char * getParameterStrValue(uint8_t index, int32_t value) const {
@@ -579,6 +672,8 @@ class Effect {
     static const char * param5_strings[NUM_PARAM5_VALUES] = {
       "AUTOPLAY",
       "TOUCH",      
+      "AUTOSYNC",
+      "TCH SYNC",
     };
     
     switch (index) 
@@ -598,13 +693,15 @@ class Effect {
     return nullptr;
   }
   
+  // Tempo and ticks may not come from the thread calling setParameter(), so they are
+  // handed over through their own atomics rather than the event queue
   inline void setTempo(uint32_t tempo) {
-    // const float bpmf = (tempo >> 16) + (tempo & 0xFFFF) / static_cast<float>(0x10000);
-    (void)tempo;
+    tempo_.store(tempo, std::memory_order_relaxed);
   }
 
   inline void tempo4ppqnTick(uint32_t counter) {
-    (void)counter;
+    tickCounter_.store(counter, std::memory_order_relaxed);
+    tickReceived_.store(true, std::memory_order_release);
   }
 
   inline void touchEvent(uint8_t id, uint8_t phase, uint32_t x, uint32_t y) {
@@ -612,10 +709,232 @@ class Effect {
     //       Audio source type effects, for instance, may require these events to trigger enveloppes and such.
     
     (void)id;
-    (void)phase;
-    (void)x;
-    (void)y;
-    
+
+    x = MIN(x, 1023U);
+    y = MIN(y, 1023U);
+
+    // Latest touch is kept in case the queue is full, applying it again has no further effect
+    touchLatest_.store(phase | (x << 8) | (y << 20), std::memory_order_relaxed);
+
+    const ControlEvent e = { EVENT_TOUCH, phase, (int32_t)x, (int32_t)y };
+    if (!events_.push(e))
+      flags_.fetch_or(k_flag_touch);
+  }
+  
+  /*===========================================================================*/
+  /* Static Members. */
+  /*===========================================================================*/
+  
+ private:
+  /*===========================================================================*/
+  /* Private Member Variables. */
+  /*===========================================================================*/
+
+  // Loop and control state read on every block, kept together in one 32-byte cache line
+  alignas(32) uint32_t bufferWritePos = 0;
+  float bufferReadPos = 0.0f;
+  uint32_t bufferLength = 0;
+  uint32_t rngState = DEFAULT_SEED;
+  int voices = 2; // never let this go below 2!
+  float grainMixGain = 0.70710678f; // 1 / sqrt(voices), recalc when voice count changes
+  bool isRecording = false;
+  bool isPlaying = false;
+  bool shouldRandomise = false;
+  bool touchEngaged = false;
+  bool grainModeEnabled = true;
+  bool isOverdubbing = false;
+
+  std::atomic_uint_fast32_t flags_;
+
+  EventQueue events_;
+  std::atomic_int_fast32_t paramValues_[NUM_PARAMS]; // latest values set, owned by the control thread
+  std::atomic_uint_fast32_t touchLatest_;            // latest touch, phase | x << 8 | y << 20
+
+  // Tempo sync. Tick phase is predicted per frame from the tempo and pulled towards
+  // the 4ppqn ticks as they arrive.
+  std::atomic_uint_fast32_t tempo_;       // 16.16 fixed point bpm
+  std::atomic_uint_fast32_t tickCounter_;
+  std::atomic_bool tickReceived_;
+  uint32_t tempoSeen_ = 0;
+  float framesPerTick_ = 0.0f;            // zero until a tempo is set
+  float tickPhase_ = 0.0f;                // in ticks, wraps at SYNC_BAR_TICKS
+  float syncFiredAgo_ = SYNC_BAR_TICKS;   // ticks since the last synced grain start, follows phase corrections
+  float syncDivFrames_[SYNC_DIVISIONS];   // syncDivTicks at the current tempo
+
+  unit_runtime_desc_t runtime_desc_;
+
+  Params params_;
+  
+  LoopSlot slots_[MAX_SLOTS];
+  uint32_t numSlots_ = 0;
+  bool mipsEnabled_ = false;   // all slots have half and quarter rate copies
+  uint32_t recSlot_ = 0;       // slot being recorded, or last recorded
+  uint32_t playSlot_ = 0;      // slot played in normal mode and followed by the grain head
+  uint32_t selectedSlot_ = 0;  // band of the last touch in the upper half
+
+  // Half and quarter rate copies are built while recording
+  MipDecimator mipDecL_[MIP_LEVELS - 1];
+  MipDecimator mipDecR_[MIP_LEVELS - 1];
+  float mipPending_[MIP_LEVELS - 1][2]; // even frame waiting for its odd pair
+  bool mipHasPending_[MIP_LEVELS - 1];
+  uint32_t mipWritePos_[MIP_LEVELS - 1];
+  uint32_t mipWrap_[MIP_LEVELS - 1];
+  bool mipWrite_ = true;
+
+  GrainBank grains_;
+  int numGrains = 0;
+  float grainCountdown = 0.f; // frames until next grain start
+  float grainHeadPos = 0.f;   // position grains are started around, moves like normal playback
+  int nextVoice = 0;
+
+  float voicePanL_[MAX_GRAINS];
+  float voicePanR_[MAX_GRAINS];
+  
+  /*===========================================================================*/
+  /* Private Methods. */
+  /*===========================================================================*/
+
+  inline uint32_t fast_rand_u32() {
+    rngState = rngState * 1664525 + 1013904223; // LCG constants
+    return rngState;
+  }
+
+  inline uint32_t fast_rand_u32_range(uint32_t min, uint32_t max) {
+    uint32_t r = fast_rand_u32();
+    uint32_t range = max - min + 1;
+    return min + (r % range);
+  }
+
+  inline float fast_randf(float min_val, float max_val) {
+    return min_val + (fast_rand_u32() / 4294967296.0f) * (max_val - min_val);
+  }
+
+  // Applies queued control events, then any that were dropped because the queue was full.
+  // Only the latest value of a dropped parameter or touch is kept.
+  fast_inline void drainEvents()
+  {
+    ControlEvent e;
+    while (events_.pop(e))
+    {
+      if (e.type == EVENT_TOUCH)
+        applyTouch(e.id, (uint32_t)e.x, (uint32_t)e.y);
+      else
+        applyParameter(e.id, e.x);
+    }
+
+    const uint32_t flags = (uint32_t)flags_.exchange(k_flags_none, std::memory_order_acquire);
+    if (flags == k_flags_none)
+      return;
+
+    for (uint8_t i = 0; i < NUM_PARAMS; ++i)
+      if (flags & (1U << i))
+        applyParameter(i, paramValues_[i].load(std::memory_order_relaxed));
+
+    if (flags & k_flag_touch)
+    {
+      const uint32_t t = (uint32_t)touchLatest_.load(std::memory_order_relaxed);
+      applyTouch(t & 0xFF, (t >> 8) & 0xFFF, t >> 20);
+    }
+  }
+
+  // Applies an already clipped parameter value to the audio state
+  inline void applyParameter(uint8_t index, int32_t value) {
+    switch (index) {
+    case PARAM1:
+      // 10bit 0-1023 parameter
+      params_.param1 = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
+      break;
+
+    case PARAM2:
+      // 10bit 0-1023 parameter
+      params_.param2 = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
+      break;
+
+    case DEPTH:
+      // Single digit base-10 fractional value, bipolar dry/wet
+      params_.depth = param_10bit_to_f32(value); // 0 .. 1000 -> 0.0 .. 1.0
+      break;
+
+    case PITCHMODE:
+      // strings type parameter, receiving index value
+      params_.param4 = value;
+      break;
+
+    case PLAYMODE:
+      // strings type parameter, receiving index value
+      params_.param5 = value;
+      break;
+
+    case DRIFT:
+      // Single digit base-10 0-99
+      params_.param6 = value;
+      break;
+
+    case SIZE:
+      // Grain size, 10-500 ms
+      params_.size = value;
+      break;
+
+    case FEEDBACK:
+      // Overdub feedback, 0-100 %
+      params_.feedback = value;
+      break;
+      
+    default:
+      break;
+    }
+  }
+
+  // Parameter value matching the audio state, used to seed paramValues_
+  inline int32_t stateParameterValue(uint8_t index) const {
+    switch (index) {
+    case PARAM1:
+      // 10bit 0-1023 parameter
+      return param_f32_to_10bit(params_.param1);
+      break;
+
+    case PARAM2:
+      // 10bit 0-1023 parameter
+      return param_f32_to_10bit(params_.param2);
+      break;
+
+    case DEPTH:
+      // Single digit base-10 fractional value, bipolar dry/wet
+      return param_f32_to_10bit(params_.depth);
+      break;
+
+    case PITCHMODE:
+      // strings type parameter, return index value
+      return params_.param4;
+      break;
+
+    case PLAYMODE:
+      // strings type parameter, return index value
+      return params_.param5;
+      break;
+
+    case DRIFT:
+      // strings type parameter, return index value
+      return params_.param6;
+      break;
+
+    case SIZE:
+      return params_.size;
+      break;
+
+    case FEEDBACK:
+      return params_.feedback;
+      break;
+      
+    default:
+      break;
+    }
+
+    return INT_MIN; // Note: will be handled as invalid
+  }
+
+  // Touch state changes, applied from Process()
+  inline void applyTouch(uint8_t phase, uint32_t x, uint32_t y) {
     switch (phase) 
     {
       case k_unit_touch_phase_began:
@@ -632,6 +951,9 @@ class Effect {
         {
           grainModeEnabled = false;
         }
+        // Band within the upper half selects the slot to record, bottom to top
+        if (y >= 512)
+          selectedSlot_ = MIN(((y - 512) * numSlots_) >> 9, numSlots_ - 1);
         touchEngaged = true;
         break;
       case k_unit_touch_phase_moved:
@@ -648,29 +970,659 @@ class Effect {
         break;
     }
   }
-  
-  /*===========================================================================*/
-  /* Static Members. */
-  /*===========================================================================*/
-  
- private:
-  /*===========================================================================*/
-  /* Private Member Variables. */
-  /*===========================================================================*/
 
-  std::atomic_uint_fast32_t flags_;
+  // Starts grains at the density set by the voice count, i.e. on average that many
+  // grains overlap. Start times are jittered so that grains neither align on block
+  // boundaries nor pile up in the same chunk.
+  // When synced, grains instead start on the tempo division closest to that interval,
+  // and are sprayed back by whole 16ths.
+  fast_inline void scheduleGrains(size_t frames, float playbackSpeed, float drift, float spray, bool synced)
+  {
+    const float sizeFrames = params_.size * 48.0f;
+    float interval = sizeFrames / voices;
+    float jitter = 0.25f;
+    float sprayStep = 0.0f;
+    const uint32_t envInc = (uint32_t)(4294967296.0f / sizeFrames);
+    const float len = (float)slots_[playSlot_].length;
+
+    if (synced)
+    {
+      const int div = nearestDivision(interval);
+      const float divTicks = syncDivTicks[div];
+      const float sinceDiv = fmodf(tickPhase_, divTicks);
+      float ahead = (sinceDiv > 0.0f) ? divTicks - sinceDiv : 0.0f;
+      // A backward phase correction can bring back a division that already started a grain
+      while (ahead + syncFiredAgo_ < 0.5f * divTicks)
+        ahead += divTicks;
+      grainCountdown = ahead * framesPerTick_;
+      interval = syncDivFrames_[div];
+      jitter = 0.0f;
+      sprayStep = framesPerTick_;
+    }
 
-  unit_runtime_desc_t runtime_desc_;
+    for (int spawned = 0; grainCountdown < frames && spawned < MAX_SPAWNS_PER_CHUNK; ++spawned)
+    {
+      if (numGrains < GRAIN_POOL)
+      {
+        const uint32_t offset = (uint32_t)grainCountdown;
+        startGrain(offset, grainHeadPos + offset * playbackSpeed, envInc, playbackSpeed, drift, spray, sprayStep);
+      }
+      if (synced)
+        syncFiredAgo_ = -grainCountdown / framesPerTick_;
+      grainCountdown += interval * (jitter > 0.0f ? fast_randf(1.0f - jitter, 1.0f + jitter) : 1.0f);
+    }
+    grainCountdown = MAX(grainCountdown - frames, 0.0f);
 
-  Params params_;
-  
-  float * allocated_buffer_;
+    grainHeadPos += frames * playbackSpeed;
+    while (grainHeadPos >= len)
+      grainHeadPos -= len;
+  }
 
-  Grain grains[MAX_GRAINS];
-  
-  /*===========================================================================*/
-  /* Private Methods. */
-  /*===========================================================================*/
+  inline void startGrain(uint32_t offset, float pos, uint32_t envInc, float playbackSpeed, float drift, float spray, float sprayStep)
+  {
+    const int i = numGrains++;
+
+    // Grains are drawn from every recorded slot, at the same fraction of each loop as the head
+    const uint32_t slot = pickGrainSlot();
+    const uint32_t slotLen = slots_[slot].length;
+    const float len = (float)slotLen;
+    if (slot != playSlot_)
+      pos *= len / (float)slots_[playSlot_].length;
+
+    // Spray scatters grains behind the head, up to the whole loop, in whole steps if given
+    if (sprayStep > 0.0f)
+      pos -= fast_rand_u32_range(0, (uint32_t)(spray * len / sprayStep)) * sprayStep;
+    else
+      pos -= fast_randf(0.0f, spray) * len;
+    while (pos < 0.0f)
+      pos += len;
+    while (pos >= len)
+      pos -= len;
+
+    // Reset to base speed
+    float baseSpeed = playbackSpeed;
+
+    if(shouldRandomise)
+    {
+      // Randomly apply octave shift
+      float octaveChance = fast_randf(0.0f, 1.0f);
+      if (octaveChance < 0.25f) {
+          baseSpeed *= 0.5f; // octave down
+      } else if (octaveChance > 0.75f) {
+          baseSpeed *= 2.0f; // octave up
+      }
+    }
+
+    const float speed = baseSpeed + fast_randf(0.0f - drift, drift);
+    const int level = mipLevel(speed);
+    grains_.readPos[i] = toMipPos(pos, level, slotLen);
+    grains_.speed[i] = speed * mipScale(level);
+    grains_.buffer[i] = slots_[slot].level[level];
+    grains_.length[i] = slotLen >> level;
+
+    // Hann sums to a near constant level when enough grains overlap, sparse grains
+    // get a flat topped Tukey window instead so that the level does not pulse.
+    // Gain compensates for the window's mean so that overall level does not depend on shape,
+    // and includes Q15 to float scaling.
+    const bool hann = (voices >= 4);
+    const float envGain = (hann ? 2.0f : (1.0f / 0.75f)) * q15_to_f32_c;
+    grains_.env[i] = hann ? grainEnvHann : grainEnvTukey;
+    grains_.envPhase[i] = 0;
+    grains_.envInc[i] = envInc;
+    grains_.startFrame[i] = offset;
+
+    grains_.gainL[i] = voicePanL_[nextVoice] * envGain;
+    grains_.gainR[i] = voicePanR_[nextVoice] * envGain;
+    nextVoice = (nextVoice + 1 < voices) ? nextVoice + 1 : 0;
+  }
+
+  // Renders each active grain over the whole chunk in turn, overlap-adding into acc.
+  // Grains reaching the end of their envelope are replaced by the last active one.
+  fast_inline void renderGrains(float * __restrict acc, size_t frames)
+  {
+    int i = 0;
+    while (i < numGrains) 
+    {
+      const loop_sample_t * buf = grains_.buffer[i];
+      const uint32_t len = grains_.length[i];
+      const float lenf = (float)len;
+      float readPos = grains_.readPos[i];
+      const float speed = grains_.speed[i];
+      uint32_t phase = grains_.envPhase[i];
+      const uint32_t inc = grains_.envInc[i];
+      const float * env = grains_.env[i];
+      const float gainL = grains_.gainL[i];
+      const float gainR = grains_.gainR[i];
+      bool done = false;
+
+      float * a = acc + grains_.startFrame[i] * 2;
+      for (size_t f = grains_.startFrame[i]; f < frames; ++f, a += 2) 
+      {
+        const uint32_t e = phase >> GRAIN_ENV_SHIFT;
+        const float ef = (phase & ((1U << GRAIN_ENV_SHIFT) - 1)) * (1.0f / (1U << GRAIN_ENV_SHIFT));
+        const float gain = env[e] + ef * (env[e + 1] - env[e]);
+
+        const uint32_t indexA = (uint32_t)readPos;
+        const uint32_t indexB = (indexA + 1 < len) ? indexA + 1 : 0; // grains wrap around the loop
+        const loop_sample_t * sA = buf + indexA * 2;
+        const loop_sample_t * sB = buf + indexB * 2;
+        const float frac = readPos - (float)indexA;
+
+        // Interpolated sum of both channels, as grains are played mono then panned
+        const float mA = (float)(sA[0] + sA[1]);
+        const float grainMono = gain * (mA + frac * ((float)(sB[0] + sB[1]) - mA));
+
+        a[0] += grainMono * gainL;
+        a[1] += grainMono * gainR;
+
+        readPos += speed;
+        if (readPos >= lenf)
+          readPos -= lenf;
+
+        const uint32_t next = phase + inc;
+        if (next < phase) 
+        {
+          done = true;
+          break;
+        }
+        phase = next;
+      }
+
+      if (done) 
+      {
+        // Last grain moves into this entry and is rendered next
+        removeGrain(i);
+        continue;
+      }
+
+      grains_.readPos[i] = readPos;
+      grains_.envPhase[i] = phase;
+      grains_.startFrame[i] = 0;
+      ++i;
+    }
+  }
+
+  inline void removeGrain(int i)
+  {
+    const int last = --numGrains;
+    grains_.readPos[i] = grains_.readPos[last];
+    grains_.speed[i] = grains_.speed[last];
+    grains_.envPhase[i] = grains_.envPhase[last];
+    grains_.envInc[i] = grains_.envInc[last];
+    grains_.gainL[i] = grains_.gainL[last];
+    grains_.gainR[i] = grains_.gainR[last];
+    grains_.startFrame[i] = grains_.startFrame[last];
+    grains_.env[i] = grains_.env[last];
+    grains_.buffer[i] = grains_.buffer[last];
+    grains_.length[i] = grains_.length[last];
+  }
+
+  // Fades out grains reading from a slot, before it is recorded over. The few ms they
+  // keep reading while the recording starts from the loop head are masked by the fade.
+  inline void dropGrains(uint32_t slot)
+  {
+    int i = 0;
+    while (i < numGrains)
+    {
+      bool inSlot = false;
+      for (int level = 0; level < MIP_LEVELS; ++level)
+        inSlot |= (grains_.buffer[i] == slots_[slot].level[level]);
+      if (inSlot && grains_.envPhase[i] == 0)
+      {
+        // Not rendered yet, nothing to fade
+        removeGrain(i);
+        continue;
+      }
+      if (inSlot)
+        releaseGrain(i);
+      ++i;
+    }
+  }
+
+  // Moves a grain onto the falling half of its envelope at the same gain, windows being
+  // symmetric, and speeds it up to end within GRAIN_RELEASE_FRAMES
+  inline void releaseGrain(int i)
+  {
+    uint32_t phase = grains_.envPhase[i];
+    if (phase < 0x80000000U)
+      phase = 0U - phase;
+    const uint32_t inc = (0U - phase) / GRAIN_RELEASE_FRAMES;
+    if (inc > grains_.envInc[i])
+      grains_.envInc[i] = inc;
+    grains_.envPhase[i] = phase;
+  }
+
+  // Random recorded slot, other than one being recorded, whose length is reset to 0 until it is done
+  inline uint32_t pickGrainSlot()
+  {
+    uint32_t ready[MAX_SLOTS];
+    uint32_t count = 0;
+    for (uint32_t slot = 0; slot < numSlots_; ++slot)
+      if (slots_[slot].length > 1)
+        ready[count++] = slot;
+    return (count > 1) ? ready[fast_rand_u32_range(0, count - 1)] : playSlot_;
+  }
+
+  // Writes a block of input to the slot being recorded, in contiguous runs up to the wrap
+  // point. Overdubs are mixed into the loop in the same read-modify-write pass, so each
+  // frame of SDRAM is touched once per block either way. Input beyond full scale saturates.
+  fast_inline void recordBlock(const float * in, size_t frames)
+  {
+    loop_sample_t * buf = slots_[recSlot_].level[0];
+    const uint32_t wrap = isOverdubbing ? bufferLength : slots_[recSlot_].capacity;
+    const float feedback = params_.feedback * 0.01f * q15_to_f32_c;
+
+    if (!isOverdubbing)
+      bufferLength = (uint32_t)MIN((size_t)bufferLength + frames, (size_t)wrap);
+
+    while (frames)
+    {
+      const uint32_t n = (uint32_t)MIN(frames, (size_t)(wrap - bufferWritePos));
+      loop_sample_t * dst = buf + bufferWritePos * 2;
+      const float * in_e = in + n * 2;
+
+      if (isOverdubbing)
+      {
+        for (; in != in_e; in += 2, dst += 2)
+        {
+          const float l = dst[0] * feedback + in[0];
+          const float r = dst[1] * feedback + in[1];
+          dst[0] = f32_to_q15(l);
+          dst[1] = f32_to_q15(r);
+          pushMipFrame(l, r);
+        }
+      }
+      else
+      {
+        for (; in != in_e; in += 2, dst += 2)
+        {
+          dst[0] = f32_to_q15(in[0]);
+          dst[1] = f32_to_q15(in[1]);
+          pushMipFrame(in[0], in[1]);
+        }
+      }
+
+      bufferWritePos += n;
+      if (bufferWritePos == wrap)
+        bufferWritePos = 0;
+      frames -= n;
+    }
+  }
+
+  // Overdubs keep the slot's length and start where it is playing, if it is, so that
+  // the new layer lines up with what is heard. The start is rounded down to a multiple
+  // of 4 frames so that half and quarter rate copies are rewritten in step, from
+  // decimators primed with the loop before it.
+  inline void startOverdub()
+  {
+    const uint32_t len = slots_[recSlot_].length;
+    uint32_t start = 0;
+    if (isPlaying && playSlot_ == recSlot_)
+      start = (uint32_t)(grainModeEnabled ? grainHeadPos : bufferReadPos) % len;
+
+    isOverdubbing = true;
+    bufferLength = len;
+    bufferWritePos = start & ~3U;
+    primeMips(bufferWritePos, len);
+  }
+
+  inline void startPlayback()
+  {
+    bufferReadPos = 0.0f;
+    isPlaying = true;
+
+    // init grain scheduler, first grain starts right away
+    grainCountdown = 0.f;
+    grainHeadPos = 0.f;
+  }
+
+  // Simple stereo playback of recorded input at desired playback rate, from the given mip level
+  fast_inline void renderNormal(float * __restrict acc, size_t frames, float playbackSpeed, int level)
+  {
+    const LoopSlot & slot = slots_[playSlot_];
+    const loop_sample_t * buf = slot.level[level];
+    const uint32_t len = slot.length >> level;
+    const float speed = playbackSpeed * mipScale(level);
+    float readPos = toMipPos(bufferReadPos, level, slot.length);
+
+    for (size_t f = 0; f < frames; ++f, acc += 2) 
+    {
+      const int indexA = (int)readPos;
+      const int indexB = (indexA + 1) % len;
+
+      const float frac = readPos - (float)indexA;
+      const float sAL = (float)buf[indexA * 2];
+      const float sAR = (float)buf[indexA * 2 + 1];
+      acc[0] += (sAL + frac * ((float)buf[indexB * 2] - sAL)) * q15_to_f32_c;
+      acc[1] += (sAR + frac * ((float)buf[indexB * 2 + 1] - sAR)) * q15_to_f32_c;
+
+      readPos += speed;
+      if (readPos >= len)
+        readPos -= len;
+    }
+
+    bufferReadPos = fromMipPos(readPos, level, slot.length);
+  }
+
+  // Picks up tempo changes, rebuilding the division table, and pulls the tick phase towards
+  // the last 4ppqn tick. Ticks are only seen once per block, so small errors are
+  // corrected gradually rather than making grain starts jump.
+  inline void updateTempo()
+  {
+    const uint32_t tempo = (uint32_t)tempo_.load(std::memory_order_relaxed);
+    if (tempo != tempoSeen_)
+    {
+      tempoSeen_ = tempo;
+      const float bpmf = (tempo >> 16) + (tempo & 0xFFFF) / static_cast<float>(0x10000);
+      framesPerTick_ = (bpmf > 0.0f) ? (48000.0f * 60.0f / 4.0f) / bpmf : 0.0f;
+      for (int i = 0; i < SYNC_DIVISIONS; ++i)
+        syncDivFrames_[i] = syncDivTicks[i] * framesPerTick_;
+    }
+
+    if (tickReceived_.exchange(false, std::memory_order_acquire))
+    {
+      const uint32_t counter = (uint32_t)tickCounter_.load(std::memory_order_relaxed);
+      float err = (float)(counter % (uint32_t)SYNC_BAR_TICKS) - tickPhase_;
+      if (err >= SYNC_BAR_TICKS * 0.5f)
+        err -= SYNC_BAR_TICKS;
+      else if (err < -SYNC_BAR_TICKS * 0.5f)
+        err += SYNC_BAR_TICKS;
+      const float step = (fabsf(err) > 0.5f) ? err : 0.25f * err;
+      tickPhase_ += step;
+      syncFiredAgo_ += step;
+      wrapTickPhase();
+    }
+  }
+
+  fast_inline void advanceTickPhase(size_t frames)
+  {
+    if (framesPerTick_ > 0.0f)
+    {
+      tickPhase_ += frames / framesPerTick_;
+      syncFiredAgo_ = MIN(syncFiredAgo_ + frames / framesPerTick_, SYNC_BAR_TICKS);
+      wrapTickPhase();
+    }
+  }
+
+  inline void wrapTickPhase()
+  {
+    while (tickPhase_ >= SYNC_BAR_TICKS)
+      tickPhase_ -= SYNC_BAR_TICKS;
+    while (tickPhase_ < 0.0f)
+      tickPhase_ += SYNC_BAR_TICKS;
+  }
+
+  // Tempo division closest to a length in frames, switching halfway between divisions in log scale
+  inline int nearestDivision(float frames) const
+  {
+    int i = 0;
+    while (i + 1 < SYNC_DIVISIONS && frames > syncDivFrames_[i] * 1.414214f)
+      ++i;
+    return i;
+  }
+
+  // Whole beats that fit in the recording, or whole 16ths if it is shorter than a beat
+  inline uint32_t snapToTempo(uint32_t len) const
+  {
+    const float beat = framesPerTick_ * 4.0f;
+    const float grid = (len >= beat) ? beat : framesPerTick_;
+    const uint32_t n = (uint32_t)(len / grid);
+    return n ? (uint32_t)(n * grid) : len;
+  }
+
+  // Picks the mip level for a playback speed, switching half an octave above each level's native rate
+  inline int mipLevel(float speed) const
+  {
+    if (!mipsEnabled_)
+      return 0;
+    return (speed > 2.828427f) ? 2 : (speed > 1.414214f) ? 1 : 0;
+  }
+
+  // SDRAM needed by a level, interleaved stereo at 1/2^level of the slot's frames
+  static inline size_t levelBytes(uint32_t frames, int level)
+  {
+    return (size_t)(frames >> level) * 2 * sizeof(loop_sample_t);
+  }
+
+  static inline size_t slotBytes(uint32_t frames, bool mips)
+  {
+    return levelBytes(frames, 0) + (mips ? levelBytes(frames, 1) + levelBytes(frames, 2) : 0);
+  }
+
+  // Prefers fewer, longer slots: the first slot gets a full BUFFER_LENGTH, then what is
+  // left is split between as many more slots as possible, up to MAX_SLOTS, each holding at
+  // least MIN_SLOT_FRAMES. Half and quarter rate copies add 3/4 to a slot's size, they are
+  // dropped if they would keep the first slot from full length. Full rate buffers are
+  // allocated first: slots that fail to allocate are left out, only failing to allocate
+  // the first one is an error. If a copy then fails to allocate, copies already allocated
+  // are freed and playback uses the full rate loops.
+  inline bool allocateSlots(const unit_runtime_desc_t * desc, size_t avail)
+  {
+    avail = (avail > SDRAM_RESERVE) ? avail - SDRAM_RESERVE : 0;
+
+    bool mips = (avail >= slotBytes(BUFFER_LENGTH, true));
+    const size_t first = MIN(avail / slotBytes(4, mips) * 4, (size_t)BUFFER_LENGTH) & ~(size_t)3;
+    if (first < RENDER_CHUNK)
+      return false;
+
+    const size_t left = avail - slotBytes((uint32_t)first, mips);
+    const uint32_t more = (uint32_t)MIN(left / slotBytes(MIN_SLOT_FRAMES, mips), (size_t)(MAX_SLOTS - 1));
+    const size_t others = more ? MIN(left / more / slotBytes(4, mips) * 4, (size_t)BUFFER_LENGTH) & ~(size_t)3 : 0;
+
+    mipsEnabled_ = false;
+    numSlots_ = 0;
+
+    for (uint32_t i = 0; i < MAX_SLOTS; ++i)
+    {
+      slots_[i].length = 0;
+      slots_[i].capacity = (uint32_t)(i ? others : first);
+      for (int level = 0; level < MIP_LEVELS; ++level)
+        slots_[i].level[level] = nullptr;
+    }
+
+    for (uint32_t i = 0; i < 1 + more; ++i)
+    {
+      if (!allocateLevel(desc, slots_[i], 0))
+        break;
+      ++numSlots_;
+    }
+    if (!numSlots_)
+      return false;
+
+    if (mips)
+    {
+      for (uint32_t i = 0; i < numSlots_ && mips; ++i)
+        for (int level = 1; level < MIP_LEVELS && mips; ++level)
+          mips = allocateLevel(desc, slots_[i], level);
+
+      if (!mips)
+        for (uint32_t i = 0; i < numSlots_; ++i)
+          for (int level = 1; level < MIP_LEVELS; ++level)
+          {
+            if (slots_[i].level[level] && desc->hooks.sdram_free)
+              desc->hooks.sdram_free((const uint8_t *)slots_[i].level[level]);
+            slots_[i].level[level] = nullptr;
+          }
+    }
+    mipsEnabled_ = mips;
+    return true;
+  }
+
+  inline bool allocateLevel(const unit_runtime_desc_t * desc, LoopSlot & slot, int level)
+  {
+    loop_sample_t * m = (loop_sample_t *)desc->hooks.sdram_alloc(levelBytes(slot.capacity, level));
+    if (!m)
+      return false;
+
+    // Make sure memory is cleared
+    buf_clr_u32((uint32_t *)m, levelBytes(slot.capacity, level) >> 2);
+    slot.level[level] = m;
+    return true;
+  }
+
+  static inline float mipScale(int level)
+  {
+    return 1.0f / (1 << level);
+  }
+
+  // Full rate frame position to mip level position, compensating decimator delay
+  inline float toMipPos(float pos, int level, uint32_t length) const
+  {
+    static const float delay[MIP_LEVELS] = { 0.0f, 22.0f, 66.0f }; // in full rate frames
+    const float len = (float)(length >> level);
+    float p = (pos + delay[level]) * mipScale(level);
+    while (p >= len)
+      p -= len;
+    return p;
+  }
+
+  inline float fromMipPos(float pos, int level, uint32_t length) const
+  {
+    static const float delay[MIP_LEVELS] = { 0.0f, 22.0f, 66.0f };
+    const float len = (float)length;
+    float p = pos * (1 << level) - delay[level];
+    while (p < 0.0f)
+      p += len;
+    while (p >= len)
+      p -= len;
+    return p;
+  }
+
+  inline void resetMips(uint32_t wrap)
+  {
+    for (int level = 0; level < MIP_LEVELS - 1; ++level)
+    {
+      mipDecL_[level].reset();
+      mipDecR_[level].reset();
+      mipHasPending_[level] = false;
+      mipWritePos_[level] = 0;
+      mipWrap_[level] = wrap >> (level + 1);
+    }
+  }
+
+  // One half-band step per level every other input frame of that level
+  fast_inline void pushMipFrame(float l, float r)
+  {
+    if (!mipsEnabled_)
+      return;
+
+    for (int level = 0; level < MIP_LEVELS - 1; ++level)
+    {
+      if (!mipHasPending_[level])
+      {
+        mipPending_[level][0] = l;
+        mipPending_[level][1] = r;
+        mipHasPending_[level] = true;
+        return;
+      }
+      mipHasPending_[level] = false;
+
+      const float inL[2] = { mipPending_[level][0], l };
+      const float inR[2] = { mipPending_[level][1], r };
+      mipDecL_[level].process(inL, &l, 1);
+      mipDecR_[level].process(inR, &r, 1);
+
+      if (mipWrite_)
+      {
+        loop_sample_t * dst = slots_[recSlot_].level[level + 1] + mipWritePos_[level] * 2;
+        dst[0] = f32_to_q15(l);
+        dst[1] = f32_to_q15(r);
+      }
+      mipWritePos_[level] = (mipWritePos_[level] + 1) % mipWrap_[level];
+    }
+  }
+
+  // Called once when recording stops, before finishMips(). Sets the loop length, then
+  // crossfades the frames recorded past the loop end into its head, so that playback
+  // wraps without a click while still reading a single frame per output frame.
+  // Free running loops give up LOOP_SEAM_FRAMES at their end for this, synced loops
+  // keep their length and use what was recorded past it, if anything.
+  inline void finishLoop(bool synced)
+  {
+    const uint32_t recorded = bufferLength;
+    uint32_t len = (synced ? snapToTempo(recorded) : recorded) & ~3U;
+    uint32_t seam = LOOP_SEAM_FRAMES;
+    if (synced)
+      seam = MIN(seam, recorded - len);
+    else if (len >= 2 * LOOP_SEAM_FRAMES)
+      len -= LOOP_SEAM_FRAMES;
+    else
+      seam = 0; // too short to spare the frames
+    seam = MIN(seam, len);
+    bufferLength = len;
+
+    // Equal power, as the loop's head and what followed it are mostly uncorrelated
+    loop_sample_t * head = slots_[recSlot_].level[0];
+    const loop_sample_t * tail = head + len * 2;
+    const float step = (float)M_PI_2 / seam;
+    for (uint32_t i = 0; i < seam; ++i, head += 2, tail += 2)
+    {
+      const float t = (i + 0.5f) * step;
+      const float gIn = sinf(t) * q15_to_f32_c;
+      const float gOut = cosf(t) * q15_to_f32_c;
+      head[0] = f32_to_q15(head[0] * gIn + tail[0] * gOut);
+      head[1] = f32_to_q15(head[1] * gIn + tail[1] * gOut);
+    }
+  }
+
+  // Called once when recording stops. Rounds loop length to a multiple of 4 so that
+  // all levels wrap on whole frames, then reruns the head of the loop, including the
+  // crossfaded seam, through the decimators, primed with its tail, so that the first
+  // frames of each level are filtered as if the loop had been playing circularly.
+  inline void finishMips()
+  {
+    const uint32_t len = bufferLength & ~3U;
+    bufferLength = len;
+    if (!mipsEnabled_ || len < 4)
+      return;
+
+    const loop_sample_t * buf = slots_[recSlot_].level[0];
+
+    primeMips(0, len);
+    for (uint32_t i = 0; i < LOOP_SEAM_FRAMES + MIP_SEAM_FRAMES; ++i)
+    {
+      const loop_sample_t * src = buf + (i % len) * 2;
+      pushMipFrame(q15_to_f32(src[0]), q15_to_f32(src[1]));
+    }
+  }
+
+  // Restarts the decimators at a multiple of 4 frames into the loop, running the
+  // MIP_SEAM_FRAMES frames before it through them without writing, so that the first
+  // frames written are filtered against the loop rather than silence.
+  inline void primeMips(uint32_t pos, uint32_t len)
+  {
+    if (!mipsEnabled_ || len < 4)
+      return;
+
+    const loop_sample_t * buf = slots_[recSlot_].level[0];
+
+    resetMips(len);
+    mipWrite_ = false;
+    for (uint32_t i = 0; i < MIP_SEAM_FRAMES; ++i)
+    {
+      const loop_sample_t * src = buf + ((pos + len - MIP_SEAM_FRAMES % len + i) % len) * 2;
+      pushMipFrame(q15_to_f32(src[0]), q15_to_f32(src[1]));
+    }
+    mipWrite_ = true;
+    for (int level = 0; level < MIP_LEVELS - 1; ++level)
+      mipWritePos_[level] = pos >> (level + 1);
+  }
+
+  // Called once when an overdub stops. The decimators lag the loop, so the frames that
+  // follow the overdub, which it left unchanged, are pushed to write out its last ones.
+  inline void flushMips()
+  {
+    const uint32_t len = bufferLength;
+    if (!mipsEnabled_ || len < 4)
+      return;
+
+    const loop_sample_t * buf = slots_[recSlot_].level[0];
+    for (uint32_t i = 0; i < MIP_SEAM_FRAMES; ++i)
+    {
+      const loop_sample_t * src = buf + ((bufferWritePos + i) % len) * 2;
+      pushMipFrame(q15_to_f32(src[0]), q15_to_f32(src[1]));
+    }
+  }
 
   /*===========================================================================*/
   /* Constants. */
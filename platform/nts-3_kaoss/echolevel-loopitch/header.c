@@ -51,7 +51,7 @@ const __unit_header genericfx_unit_header_t unit_header = {
     .unit_id = 0x0U,                                          // ID for this unit. Scoped within the context of a given dev_id.
     .version = 0x00010000U,                                   // This unit's version: major.minor.patch (major<<16 minor<<8 patch).
     .name = "loopitch",                                          // Name for this unit, will be displayed on device
-    .num_params = 6,                                          // Number of valid parameter descriptors. (max. 8)
+    .num_params = 8,                                          // Number of valid parameter descriptors. (max. 8)
     
     .params = {
       // Format: min, max, center, default, type, frac. bits, frac. mode, <reserved>, name
@@ -68,12 +68,12 @@ const __unit_header genericfx_unit_header_t unit_header = {
       // Example of a strings type parameter
       {0, 3, 0, 1, k_unit_param_type_strings, 0, 0, 0, {"PITCHMODE"}},
       
-      {0, 1, 0, 0, k_unit_param_type_strings, 0, 0, 0, {"PLAYMODE"}},
+      {0, 3, 0, 0, k_unit_param_type_strings, 0, 0, 0, {"PLAYMODE"}},
 
       {0, 99, 10, 0, k_unit_param_type_none, 0, 0, 0, {"DRIFT"}},
 
-      {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
-      {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}}},
+      {10, 500, 0, 100, k_unit_param_type_msec, 0, 0, 0, {"SIZE"}},
+      {0, 100, 0, 0, k_unit_param_type_percent, 0, 0, 0, {"FEEDBACK"}}},
   },
   .default_mappings = {
     // By default, the parameters described above will be mapped to controls as described below.
@@ -93,13 +93,16 @@ const __unit_header genericfx_unit_header_t unit_header = {
     // PARAM4 set to the fixed value of 1
     {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 3, 1},
     
-    // PARAM5 sets playback mode - continuous (default) or touch controlled
-    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 1, 0},
+    // PARAM5 sets playback mode - continuous (default) or touch controlled, optionally tempo synced
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 3, 0},
 
     // PARAM6 sets pitch drift amount for randomised L/R playheads
     {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 99, 10},
 
-    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 0, 0},
-    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 0, 0}
+    // SIZE sets grain length in ms
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 10, 500, 100},
+
+    // FEEDBACK overdubs new recordings onto a slot's loop, 0 replaces it
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 100, 0}
   }
 };
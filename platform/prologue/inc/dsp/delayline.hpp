@@ -69,6 +69,7 @@ namespace dsp {
     DelayLine(void) :
       mLine(0),
       mFracZ(0),
+      mApZ(0),
       mSize(0),
       mMask(0),
       mWriteIdx(0)
@@ -84,6 +85,7 @@ namespace dsp {
     DelayLine(float *ram, size_t line_size) :
       mLine(ram),
       mFracZ(0),
+      mApZ(0),
       mSize(line_size),
       mMask(line_size-1),
       mWriteIdx(0)
@@ -167,6 +169,153 @@ namespace dsp {
       mFracZ = s0;
       return y;
     }
+
+    /**
+     * Write a block of samples to the head of the delay line
+     *
+     * @param s Pointer to samples to write, oldest first
+     * @param frames Number of samples to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void write(const float * __restrict s, const size_t frames) {
+      for (size_t i = 0; i < frames; ++i)
+        mLine[(mWriteIdx--) & mMask] = s[i];
+    }
+
+    /**
+     * Fetch four consecutive samples from the delay line with a single wrap check.
+     *
+     * @param idx Raw index of first sample, will be masked
+     * @param x Destination for the four samples
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fetch4(uint32_t idx, float * __restrict x) {
+      idx &= mMask;
+      if (idx + 3 <= mMask) {
+        const float * __restrict p = mLine + idx;
+        x[0] = p[0]; x[1] = p[1]; x[2] = p[2]; x[3] = p[3];
+      }
+      else {
+        x[0] = mLine[idx];
+        x[1] = mLine[(idx+1) & mMask];
+        x[2] = mLine[(idx+2) & mMask];
+        x[3] = mLine[(idx+3) & mMask];
+      }
+    }
+
+    /**
+     * Read a sample from the delay line at a fractional position from current write index, using 4-point Hermite interpolation.
+     *
+     * @param pos Offset from write index as floating point, should be >= 2.
+     * @return Interpolated sample at given fractional position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float readFracHermite(const float pos) {
+      const uint32_t base = (uint32_t)pos;
+      const float frac = pos - base;
+      float x[4];
+      fetch4(mWriteIdx + base - 1, x);
+      return hermiteintf(frac, x[0], x[1], x[2], x[3]);
+    }
+
+    /**
+     * Read a sample from the delay line at a fractional position from current write index, using 3rd-order Lagrange interpolation.
+     *
+     * @param pos Offset from write index as floating point, should be >= 2.
+     * @return Interpolated sample at given fractional position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float readFracLagrange(const float pos) {
+      const uint32_t base = (uint32_t)pos;
+      const float frac = pos - base;
+      float x[4];
+      fetch4(mWriteIdx + base - 1, x);
+      return lagrangeintf(frac, x[0], x[1], x[2], x[3]);
+    }
+
+    /**
+     * Read a sample from the delay line at a fractional position from current write index, using first-order allpass interpolation.
+     *
+     * @param pos Offset from write index as floating point.
+     * @return Interpolated sample at given fractional position from write index
+     *
+     * @note Keeps state from previous call, must be called exactly once per sample. Best suited to slowly varying positions.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float readFracAllpass(const float pos) {
+      const uint32_t base = (uint32_t)pos;
+      const float frac = pos - base;
+      const float eta = (1.f - frac) / (1.f + frac);
+      const float y = eta * (read(base) - mApZ) + read(base+1);
+      mApZ = y;
+      return y;
+    }
+
+    /**
+     * Read a block of samples at fractional positions, using 4-point Hermite interpolation.
+     *
+     * @param pos Offsets as floating point, pos[i] as would be passed to readFracHermite() right after writing frame i, should be >= 2.
+     * @param out Destination for interpolated samples
+     * @param frames Number of samples to read
+     *
+     * @note The whole block of input samples must already have been written.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void readFracHermite(const float * __restrict pos, float * __restrict out, const size_t frames) {
+      uint32_t head = mWriteIdx + frames - 2;
+      for (size_t i = 0; i < frames; ++i, --head) {
+        const uint32_t base = (uint32_t)pos[i];
+        const float frac = pos[i] - base;
+        float x[4];
+        fetch4(head + base, x);
+        out[i] = hermiteintf(frac, x[0], x[1], x[2], x[3]);
+      }
+    }
+
+    /**
+     * Read a block of samples at fractional positions, using 3rd-order Lagrange interpolation.
+     *
+     * @param pos Offsets as floating point, pos[i] as would be passed to readFracLagrange() right after writing frame i, should be >= 2.
+     * @param out Destination for interpolated samples
+     * @param frames Number of samples to read
+     *
+     * @note The whole block of input samples must already have been written.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void readFracLagrange(const float * __restrict pos, float * __restrict out, const size_t frames) {
+      uint32_t head = mWriteIdx + frames - 2;
+      for (size_t i = 0; i < frames; ++i, --head) {
+        const uint32_t base = (uint32_t)pos[i];
+        const float frac = pos[i] - base;
+        float x[4];
+        fetch4(head + base, x);
+        out[i] = lagrangeintf(frac, x[0], x[1], x[2], x[3]);
+      }
+    }
+
+    /**
+     * Read a block of samples at fractional positions, using first-order allpass interpolation.
+     *
+     * @param pos Offsets as floating point, pos[i] as would be passed to readFracAllpass() right after writing frame i.
+     * @param out Destination for interpolated samples
+     * @param frames Number of samples to read
+     *
+     * @note The whole block of input samples must already have been written.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void readFracAllpass(const float * __restrict pos, float * __restrict out, const size_t frames) {
+      uint32_t head = mWriteIdx + frames - 1;
+      float z = mApZ;
+      for (size_t i = 0; i < frames; ++i, --head) {
+        const uint32_t base = (uint32_t)pos[i];
+        const float frac = pos[i] - base;
+        const float eta = (1.f - frac) / (1.f + frac);
+        const uint32_t idx = (head + base) & mMask;
+        z = eta * (mLine[idx] - z) + mLine[(idx+1) & mMask];
+        out[i] = z;
+      }
+      mApZ = z;
+    }
       
       
     /*===========================================================================*/
@@ -175,6 +324,7 @@ namespace dsp {
       
     float   *mLine;
     float    mFracZ;
+    float    mApZ;
     size_t   mSize;
     size_t   mMask;
     uint32_t mWriteIdx;
@@ -199,6 +349,7 @@ namespace dsp {
      */
     DualDelayLine(void) :
       mLine(0),
+      mApZ(),
       mSize(0),
       mMask(0),
       mWriteIdx(0)
@@ -213,6 +364,7 @@ namespace dsp {
      *
      */
     DualDelayLine(f32pair_t *ram, size_t line_size) :
+      mApZ(),
       mWriteIdx(0)
     {
       setMemory(ram, line_size);
@@ -298,6 +450,162 @@ namespace dsp {
       return y;
     }
 
+    /**
+     * Write a block of sample pairs to the delay line
+     *
+     * @param p Pointer to sample pairs to write, oldest first
+     * @param frames Number of sample pairs to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void write(const f32pair_t * __restrict p, const size_t frames) {
+      for (size_t i = 0; i < frames; ++i)
+        mLine[(mWriteIdx--) & mMask] = p[i];
+    }
+
+    /**
+     * Fetch four consecutive sample pairs from the delay line with a single wrap check.
+     *
+     * @param idx Raw index of first sample pair, will be masked
+     * @param x Destination for the four sample pairs
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fetch4(uint32_t idx, f32pair_t * __restrict x) {
+      idx &= mMask;
+      if (idx + 3 <= mMask) {
+        const f32pair_t * __restrict p = mLine + idx;
+        x[0] = p[0]; x[1] = p[1]; x[2] = p[2]; x[3] = p[3];
+      }
+      else {
+        x[0] = mLine[idx];
+        x[1] = mLine[(idx+1) & mMask];
+        x[2] = mLine[(idx+2) & mMask];
+        x[3] = mLine[(idx+3) & mMask];
+      }
+    }
+
+    /**
+     * Read a sample pair from the delay line at a fractional position from current write index, using 4-point Hermite interpolation.
+     *
+     * @param pos Offset from write index as floating point, should be >= 2.
+     * @return Interpolated sample pair at given fractional position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    f32pair_t readFracHermite(const float pos) {
+      const uint32_t base = (uint32_t)pos;
+      const float frac = pos - base;
+      f32pair_t x[4];
+      fetch4(mWriteIdx + base - 1, x);
+      return f32pair(hermiteintf(frac, x[0].a, x[1].a, x[2].a, x[3].a),
+                     hermiteintf(frac, x[0].b, x[1].b, x[2].b, x[3].b));
+    }
+
+    /**
+     * Read a sample pair from the delay line at a fractional position from current write index, using 3rd-order Lagrange interpolation.
+     *
+     * @param pos Offset from write index as floating point, should be >= 2.
+     * @return Interpolated sample pair at given fractional position from write index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    f32pair_t readFracLagrange(const float pos) {
+      const uint32_t base = (uint32_t)pos;
+      const float frac = pos - base;
+      f32pair_t x[4];
+      fetch4(mWriteIdx + base - 1, x);
+      return f32pair(lagrangeintf(frac, x[0].a, x[1].a, x[2].a, x[3].a),
+                     lagrangeintf(frac, x[0].b, x[1].b, x[2].b, x[3].b));
+    }
+
+    /**
+     * Read a sample pair from the delay line at a fractional position from current write index, using first-order allpass interpolation.
+     *
+     * @param pos Offset from write index as floating point.
+     * @return Interpolated sample pair at given fractional position from write index
+     *
+     * @note Keeps state from previous call, must be called exactly once per sample. Best suited to slowly varying positions.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    f32pair_t readFracAllpass(const float pos) {
+      const uint32_t base = (uint32_t)pos;
+      const float frac = pos - base;
+      const float eta = (1.f - frac) / (1.f + frac);
+      const f32pair_t p0 = read(base);
+      const f32pair_t p1 = read(base+1);
+      mApZ.a = eta * (p0.a - mApZ.a) + p1.a;
+      mApZ.b = eta * (p0.b - mApZ.b) + p1.b;
+      return mApZ;
+    }
+
+    /**
+     * Read a block of sample pairs at fractional positions, using 4-point Hermite interpolation.
+     *
+     * @param pos Offsets as floating point, pos[i] as would be passed to readFracHermite() right after writing frame i, should be >= 2.
+     * @param out Destination for interpolated sample pairs
+     * @param frames Number of sample pairs to read
+     *
+     * @note The whole block of input sample pairs must already have been written.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void readFracHermite(const float * __restrict pos, f32pair_t * __restrict out, const size_t frames) {
+      uint32_t head = mWriteIdx + frames - 2;
+      for (size_t i = 0; i < frames; ++i, --head) {
+        const uint32_t base = (uint32_t)pos[i];
+        const float frac = pos[i] - base;
+        f32pair_t x[4];
+        fetch4(head + base, x);
+        out[i].a = hermiteintf(frac, x[0].a, x[1].a, x[2].a, x[3].a);
+        out[i].b = hermiteintf(frac, x[0].b, x[1].b, x[2].b, x[3].b);
+      }
+    }
+
+    /**
+     * Read a block of sample pairs at fractional positions, using 3rd-order Lagrange interpolation.
+     *
+     * @param pos Offsets as floating point, pos[i] as would be passed to readFracLagrange() right after writing frame i, should be >= 2.
+     * @param out Destination for interpolated sample pairs
+     * @param frames Number of sample pairs to read
+     *
+     * @note The whole block of input sample pairs must already have been written.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void readFracLagrange(const float * __restrict pos, f32pair_t * __restrict out, const size_t frames) {
+      uint32_t head = mWriteIdx + frames - 2;
+      for (size_t i = 0; i < frames; ++i, --head) {
+        const uint32_t base = (uint32_t)pos[i];
+        const float frac = pos[i] - base;
+        f32pair_t x[4];
+        fetch4(head + base, x);
+        out[i].a = lagrangeintf(frac, x[0].a, x[1].a, x[2].a, x[3].a);
+        out[i].b = lagrangeintf(frac, x[0].b, x[1].b, x[2].b, x[3].b);
+      }
+    }
+
+    /**
+     * Read a block of sample pairs at fractional positions, using first-order allpass interpolation.
+     *
+     * @param pos Offsets as floating point, pos[i] as would be passed to readFracAllpass() right after writing frame i.
+     * @param out Destination for interpolated sample pairs
+     * @param frames Number of sample pairs to read
+     *
+     * @note The whole block of input sample pairs must already have been written.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void readFracAllpass(const float * __restrict pos, f32pair_t * __restrict out, const size_t frames) {
+      uint32_t head = mWriteIdx + frames - 1;
+      f32pair_t z = mApZ;
+      for (size_t i = 0; i < frames; ++i, --head) {
+        const uint32_t base = (uint32_t)pos[i];
+        const float frac = pos[i] - base;
+        const float eta = (1.f - frac) / (1.f + frac);
+        const uint32_t idx = (head + base) & mMask;
+        const f32pair_t p0 = mLine[idx];
+        const f32pair_t p1 = mLine[(idx+1) & mMask];
+        z.a = eta * (p0.a - z.a) + p1.a;
+        z.b = eta * (p0.b - z.b) + p1.b;
+        out[i] = z;
+      }
+      mApZ = z;
+    }
+
     /**
      * Read a single sample from the delay line's primary channel at given position from current write index.
      *
@@ -386,6 +694,7 @@ namespace dsp {
       
     f32pair_t *mLine;
     f32pair_t  mFracZ;
+    f32pair_t  mApZ;
     size_t     mSize;
     size_t     mMask;
     uint32_t   mWriteIdx;
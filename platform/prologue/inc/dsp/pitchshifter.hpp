@@ -0,0 +1,341 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    pitchshifter.hpp
+ * @brief   Delay based pitch shifter.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "float_math.h"
+#include "delayline.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Stereo pitch shifter using two crossfaded read heads on a delay line.
+   *
+   * Both heads sweep the delay at a rate set by the pitch ratio, half a window
+   * apart. When a head reaches the end of the window it jumps back while the
+   * other one is at full gain, so jumps are hidden by the crossfade.
+   *
+   * Head positions are kept as a wrapping Q32 phase. Reads use 4-point Hermite
+   * interpolation, crossfade gains come from a precomputed window table.
+   */
+  struct PitchShifter {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    enum {
+      k_window_hann = 0,    /**< sin^2 window, constant amplitude sum, best for correlated signals. */
+      k_window_sine,        /**< sin window, constant power sum, fuller sound on dense material. */
+      k_num_window_shapes,
+    };
+
+    enum {
+      k_lut_size = 128,     /**< Window table resolution. */
+      k_max_frames = 64,    /**< Frames processed per internal chunk. */
+      k_min_window = 64,    /**< Minimum window length in samples. */
+      k_min_delay = 2,      /**< Minimum read offset for Hermite reads. */
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    PitchShifter(void) :
+      mLine(),
+      mPhase(0),
+      mPhaseInc(0),
+      mRatio(1.f),
+      mWindow(k_min_window),
+      mShape(k_window_hann)
+    {
+      setWindowShape(k_window_hann);
+    }
+
+    /**
+     * Constructor with explicit memory area to use as backing buffer for delay line.
+     *
+     * @param ram Pointer to memory buffer
+     * @param line_size Size in float pairs of memory buffer
+     */
+    PitchShifter(f32pair_t *ram, size_t line_size) :
+      mLine(ram, line_size),
+      mPhase(0),
+      mPhaseInc(0),
+      mRatio(1.f),
+      mWindow(k_min_window),
+      mShape(k_window_hann)
+    {
+      setWindowShape(k_window_hann);
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set the memory area to use as backing buffer for the delay line.
+     *
+     * @param ram Pointer to memory buffer
+     * @param line_size Size in float pairs of memory buffer
+     *
+     * @note Will round size to next power of two. Window length is clipped to fit.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMemory(f32pair_t *ram, size_t line_size) {
+      mLine.setMemory(ram, line_size);
+      setWindowSize(mWindow);
+    }
+
+    /**
+     * Zero clear the delay line and reset head positions.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void clear(void) {
+      mLine.clear();
+      mPhase = 0;
+    }
+
+    /**
+     * Set window length, which is the delay range swept by each head.
+     *
+     * @param samples Window length in samples
+     *
+     * @note Longer windows smear transients less often but add more latency, 20-50ms is typical.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setWindowSize(float samples) {
+      const float max = (float)mLine.mSize - (k_min_delay + 2);
+      if (samples > max)
+        samples = max;
+      if (samples < k_min_window)
+        samples = k_min_window;
+      mWindow = samples;
+      updatePhaseInc();
+    }
+
+    /**
+     * Set pitch ratio.
+     *
+     * @param ratio Output to input frequency ratio, clipped to [0.25, 4]
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setRatio(float ratio) {
+      ratio = clipminmaxf(0.25f, ratio, 4.f);
+      mRatio = ratio;
+      updatePhaseInc();
+    }
+
+    /**
+     * Set pitch shift in semitones.
+     *
+     * @param semitones Shift amount, clipped to [-24, 24]
+     *
+     * @note Uses powf(), fastpow2f() being inaccurate for positive exponents. Avoid calling per sample.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setSemitones(const float semitones) {
+      setRatio(powf(2.f, clipminmaxf(-24.f, semitones, 24.f) * (1.f / 12.f)));
+    }
+
+    /**
+     * Select crossfade window shape and fill the window table.
+     *
+     * @param shape One of k_window_hann, k_window_sine
+     *
+     * @note Should not be called from the audio loop.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void setWindowShape(const uint32_t shape) {
+      mShape = (shape < k_num_window_shapes) ? shape : (uint32_t)k_window_hann;
+
+      // sin(pi*i/N) by rotation, one extra point for interpolation
+      const double delta = 3.141592653589793 / k_lut_size;
+      const double cd = __builtin_cos(delta);
+      const double sd = __builtin_sin(delta);
+      double c = 1.0, s = 0.0;
+      for (uint32_t i = 0; i <= k_lut_size; ++i) {
+        const float w = (s > 0.0) ? (float)s : 0.f;
+        mLut[i] = (mShape == k_window_sine) ? w : w * w;
+        const double cn = c * cd - s * sd;
+        s = s * cd + c * sd;
+        c = cn;
+      }
+    }
+
+    /**
+     * Get current pitch ratio.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float getRatio(void) const {
+      return mRatio;
+    }
+
+    /**
+     * Process a single sample pair.
+     *
+     * @param in Input sample pair
+     * @return Pitch shifted sample pair
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    f32pair_t process(const f32pair_t in) {
+      mLine.write(in);
+
+      const uint32_t pa = mPhase;
+      const uint32_t pb = pa + k_half_phase;
+      mPhase = pa + mPhaseInc;
+
+      const float scale = mWindow * k_phase_to_float;
+      const f32pair_t a = mLine.readFracHermite(k_min_delay + pa * scale);
+      const f32pair_t b = mLine.readFracHermite(k_min_delay + pb * scale);
+      const float ga = window(pa);
+      const float gb = window(pb);
+      return f32pair(ga * a.a + gb * b.a, ga * a.b + gb * b.b);
+    }
+
+    /**
+     * Process a block of interleaved stereo samples.
+     *
+     * @param in Input samples, interleaved stereo
+     * @param out Output samples, interleaved stereo, may be the same as in
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast")))
+    void process(const float * in, float * out, size_t frames) {
+      process((const f32pair_t *)in, (f32pair_t *)out, frames);
+    }
+
+    /**
+     * Process a block of sample pairs.
+     *
+     * @param in Input sample pairs
+     * @param out Output sample pairs, may be the same as in
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast")))
+    void process(const f32pair_t * in, f32pair_t * out, size_t frames) {
+      float pos_a[k_max_frames];
+      float pos_b[k_max_frames];
+      float gain_a[k_max_frames];
+      float gain_b[k_max_frames];
+      f32pair_t head_a[k_max_frames];
+      f32pair_t head_b[k_max_frames];
+
+      const float scale = mWindow * k_phase_to_float;
+      const uint32_t inc = mPhaseInc;
+
+      while (frames) {
+        const size_t n = (frames < k_max_frames) ? frames : (size_t)k_max_frames;
+
+        // Head positions and gains for the whole chunk
+        uint32_t pa = mPhase;
+        for (size_t i = 0; i < n; ++i, pa += inc) {
+          const uint32_t pb = pa + k_half_phase;
+          pos_a[i] = k_min_delay + pa * scale;
+          pos_b[i] = k_min_delay + pb * scale;
+          gain_a[i] = window(pa);
+          gain_b[i] = window(pb);
+        }
+        mPhase = pa;
+
+        // Whole chunk must be written before block reads
+        mLine.write(in, n);
+        mLine.readFracHermite(pos_a, head_a, n);
+        mLine.readFracHermite(pos_b, head_b, n);
+
+        for (size_t i = 0; i < n; ++i) {
+          out[i].a = gain_a[i] * head_a[i].a + gain_b[i] * head_b[i].a;
+          out[i].b = gain_a[i] * head_a[i].b + gain_b[i] * head_b[i].b;
+        }
+
+        in += n;
+        out += n;
+        frames -= n;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DualDelayLine mLine;
+    float         mLut[k_lut_size + 1];
+    uint32_t      mPhase;
+    uint32_t      mPhaseInc;
+    float         mRatio;
+    float         mWindow;
+    uint32_t      mShape;
+
+  private:
+
+    static constexpr float k_phase_to_float = 2.3283064365386963e-10f; // 2^-32
+    static constexpr uint32_t k_half_phase = 0x80000000U;
+    static constexpr uint32_t k_lut_shift = 25; // 32 - log2(k_lut_size)
+
+    /**
+     * Derive Q32 phase increment, delay sweeps by (1 - ratio) samples per sample.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void updatePhaseInc(void) {
+      mPhaseInc = (uint32_t)(int32_t)((1.f - mRatio) / mWindow * 4294967296.f);
+    }
+
+    /**
+     * Window gain at Q32 phase, linearly interpolated from table.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float window(const uint32_t phase) const {
+      const uint32_t i = phase >> k_lut_shift;
+      const float fr = (phase & ((1U << k_lut_shift) - 1)) * (1.f / (1U << k_lut_shift));
+      return mLut[i] + fr * (mLut[i+1] - mLut[i]);
+    }
+
+  };
+
+}
+
+/** @} */
@@ -113,6 +113,32 @@ namespace dsp {
     {
       w0 = f32_to_q31(2.f * w);
     }
+
+    /**
+     * Set LFO frequency from tempo
+     *
+     * @param bpm Tempo in beats per minute, e.g.: fx_get_bpmf()
+     * @param beats Duration of one LFO cycle in beats (quarter notes)
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTempo(const float bpm, const float beats, const float fsrecip)
+    {
+      setF0(bpm / (60.f * beats), fsrecip);
+    }
+
+    /**
+     * Reset phase on tempo ticks that fall on a cycle boundary
+     *
+     * @param counter Tick counter, as received by tempo4ppqnTick()
+     * @param ticks Duration of one LFO cycle in 4PPQN ticks (4 per beat)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void tempo4ppqnTick(const uint32_t counter, const uint32_t ticks)
+    {
+      if (ticks && (counter % ticks) == 0)
+        reset();
+    }
     
     // --- Sinusoids --------------
 
@@ -290,6 +316,155 @@ namespace dsp {
       const q31_t phi = phi0 + (f32_to_q31(offset)<<1);
       return (phi < 0) ? 0.f : 1.f;
     }
+
+    // --- Block Fills --------------
+    //
+    // Write the waveform value for n consecutive phases, starting at the
+    // current phase, and leave the phase n cycles forward. Equivalent to
+    // calling the matching getter followed by cycle() n times.
+
+    /**
+     * Step phase n cycles forward
+     *
+     * @param n Number of cycles
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void cycle(const uint32_t n)
+    {
+      phi0 = (q31_t)((uint32_t)phi0 + (uint32_t)w0 * n);
+    }
+
+    /**
+     * Fill buffer with bipolar sine wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_sine_bi(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w) {
+        const float phif = q31_to_f32(phi);
+        out[i] = 4 * phif * (si_fabsf(phif) - 1.f);
+      }
+      phi0 = phi;
+    }
+
+    /**
+     * Fill buffer with positive unipolar sine wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_sine_uni(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w) {
+        const float phif = q31_to_f32(phi);
+        out[i] = 0.5f + 2 * phif * (si_fabsf(phif) - 1.f);
+      }
+      phi0 = phi;
+    }
+
+    /**
+     * Fill buffer with bipolar triangle wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_triangle_bi(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w)
+        out[i] = q31_to_f32(qsub(q31abs(phi),0x40000000)<<1);
+      phi0 = phi;
+    }
+
+    /**
+     * Fill buffer with positive unipolar triangle wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_triangle_uni(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w)
+        out[i] = si_fabsf(q31_to_f32(phi));
+      phi0 = phi;
+    }
+
+    /**
+     * Fill buffer with bipolar saw wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_saw_bi(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w)
+        out[i] = q31_to_f32(phi);
+      phi0 = phi;
+    }
+
+    /**
+     * Fill buffer with positive unipolar saw wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_saw_uni(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w)
+        out[i] = q31_to_f32(qadd((phi>>1),0x40000000));
+      phi0 = phi;
+    }
+
+    /**
+     * Fill buffer with bipolar square wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_square_bi(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w)
+        out[i] = (phi < 0) ? -1.f : 1.f;
+      phi0 = phi;
+    }
+
+    /**
+     * Fill buffer with positive unipolar square wave
+     *
+     * @param out Destination buffer
+     * @param n Number of values to write
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_square_uni(float * __restrict out, const uint32_t n)
+    {
+      q31_t phi = phi0;
+      const q31_t w = w0;
+      for (uint32_t i = 0; i < n; ++i, phi += w)
+        out[i] = (phi < 0) ? 0.f : 1.f;
+      phi0 = phi;
+    }
       
     /*===========================================================================*/
     /* Members Vars                                                              */
@@ -97,8 +97,9 @@ void OSC_CYCLE(const user_osc_param_t * const params,
   dsp::BiQuad &prelpf = s_waves.prelpf;
   dsp::BiQuad &postlpf = s_waves.postlpf;
   
-  q31_t * __restrict y = (q31_t *)yn;
-  const q31_t * y_e = y + frames;
+  // Note: output buffer first holds float samples, converted to q31 in place after soft clipping
+  float * y = (float *)yn;
+  const float * y_e = y + frames;
   
   for (; y != y_e; ) {
 
@@ -116,9 +117,8 @@ void OSC_CYCLE(const user_osc_param_t * const params,
     sig += s.dither * osc_white();
     sig = si_roundf(sig * s.bitres) * s.bitresrcp;
     sig = postlpf.process_fo(sig);
-    sig = osc_softclipf(0.125f, sig);
     
-    *(y++) = f32_to_q31(sig);
+    *(y++) = sig;
     
     phi0 += s.w00;
     phi0 -= (uint32_t)phi0;
@@ -128,6 +128,13 @@ void OSC_CYCLE(const user_osc_param_t * const params,
     phisub -= (uint32_t)phisub;
     lfoz += lfo_inc;
   }
+
+  // Soft clip at 2x rate so that its harmonics do not fold back
+  float * sig = (float *)yn;
+  s_waves.softclip_os.process(sig, sig, frames, [](float x) { return osc_softclipf(0.125f, x); });
+
+  for (uint32_t i = 0; i < frames; ++i)
+    yn[i] = f32_to_q31(sig[i]);
   
   s.phi0 = phi0;
   s.phi1 = phi1;
@@ -41,6 +41,7 @@
 
 #include "userosc.h"
 #include "biquad.hpp"
+#include "oversampler.hpp"
 
 struct Waves {
 
@@ -131,6 +132,7 @@ struct Waves {
     params = Params();
     prelpf.mCoeffs.setPoleLP(0.8f);
     postlpf.mCoeffs.setFOLP(osc_tanpif(0.45f));
+    softclip_os.reset();
   }
   
   inline void updatePitch(float w0) {
@@ -196,4 +198,5 @@ struct Waves {
   State       state;
   Params      params;
   dsp::BiQuad prelpf, postlpf;
+  dsp::Oversampler<2> softclip_os;
 };